@@ -0,0 +1,108 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Shared helpers for the benchmark harnesses: wall-clock timing, resident
+ * set size sampling, thread pinning, and a small per-thread PRNG so size
+ * distributions are reproducible and free of rand()'s internal locking.
+ */
+
+static inline uint64_t bench_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * @brief Sample the process resident set size from /proc/self/status
+ *
+ * @return The current RSS in kilobytes, or 0 if it cannot be read
+ */
+static inline long bench_rss_kb() {
+  FILE *f = fopen("/proc/self/status", "r");
+  if (!f) {
+    return 0;
+  }
+
+  char line[256];
+  long kb = 0;
+  while (fgets(line, sizeof(line), f)) {
+    if (sscanf(line, "VmRSS: %ld kB", &kb) == 1) {
+      break;
+    }
+  }
+  fclose(f);
+  return kb;
+}
+
+/**
+ * @brief Pin the calling thread to one CPU so scaling curves are stable
+ *
+ * @param cpu The CPU to pin to (wrapped to the number of online CPUs)
+ */
+static inline void bench_pin(int cpu) {
+  long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (ncpus < 1) {
+    return;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % ncpus, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* xorshift64star: fast, decent quality, one word of state per thread */
+static inline uint64_t bench_rand(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 2685821657736338717ull;
+}
+
+/**
+ * @brief Draw an allocation size from a named distribution
+ *
+ * "small" covers the exact-fit freelists, "large" the overflow list, and
+ * "mixed" both; a min:max pair gives a uniform range.
+ *
+ * @param dist The distribution name or "min:max" string
+ * @param state The PRNG state of the calling thread
+ *
+ * @return The number of bytes to allocate
+ */
+static inline size_t bench_size(const char *dist, uint64_t *state) {
+  size_t lo = 8;
+  size_t hi = 512;
+
+  if (!strcmp(dist, "small")) {
+    lo = 8;
+    hi = 464;
+  } else if (!strcmp(dist, "large")) {
+    lo = 512;
+    hi = 4096;
+  } else if (!strcmp(dist, "mixed")) {
+    lo = 8;
+    hi = 2048;
+  } else {
+    sscanf(dist, "%zu:%zu", &lo, &hi);
+  }
+
+  if (hi <= lo) {
+    return lo;
+  }
+  return lo + bench_rand(state) % (hi - lo + 1);
+}
+
+#endif // __BENCH_H__
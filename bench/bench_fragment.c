@@ -0,0 +1,86 @@
+/*
+ * Fragmentation torture loop: interleave allocations of wildly different
+ * sizes and lifetimes, then free every other block to shred the heap into
+ * small holes, and measure how much the allocator recovers. Reports RSS
+ * and the ratio of resident memory to live bytes after each phase; a
+ * perfect allocator keeps the ratio near 1.
+ *
+ * usage: bench_fragment [rounds] [slots]
+ */
+#include "bench.h"
+#include "my_malloc.h"
+
+static void report(const char *phase, size_t liveBytes) {
+  long rss = bench_rss_kb();
+  printf("%-12s %10zu live bytes %10ld rss_kb  overhead %.2fx\n",
+         phase, liveBytes, rss,
+         liveBytes ? (rss * 1024.0) / liveBytes : 0.0);
+}
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  int nslots = argc > 2 ? atoi(argv[2]) : 20000;
+
+  void **slots = calloc(nslots, sizeof(void *));
+  size_t *sizes = calloc(nslots, sizeof(size_t));
+  uint64_t rng = 0x9e3779b97f4a7c15ull;
+  size_t liveBytes = 0;
+
+  for (int r = 0; r < rounds; r++) {
+    // Fill every slot with a mix of small and large blocks.
+    for (int i = 0; i < nslots; i++) {
+      if (slots[i]) {
+        continue;
+      }
+      size_t size = (i % 7 == 0) ? bench_size("large", &rng)
+                                 : bench_size("small", &rng);
+      slots[i] = myMalloc(size);
+      if (!slots[i]) {
+        fprintf(stderr, "myMalloc failed\n");
+        return 1;
+      }
+      memset(slots[i], 0x3c, size);
+      sizes[i] = size;
+      liveBytes += size;
+    }
+    report("filled", liveBytes);
+
+    // Free every other block, leaving a comb of small holes.
+    for (int i = 0; i < nslots; i += 2) {
+      if (slots[i]) {
+        myFree(slots[i]);
+        liveBytes -= sizes[i];
+        slots[i] = NULL;
+      }
+    }
+    report("shredded", liveBytes);
+
+    // Reallocate the holes at different sizes; growth in the overhead
+    // column across rounds is external fragmentation the allocator
+    // failed to recover.
+    for (int i = 0; i < nslots; i += 2) {
+      size_t size = bench_size("mixed", &rng);
+      slots[i] = myMalloc(size);
+      if (!slots[i]) {
+        fprintf(stderr, "myMalloc failed\n");
+        return 1;
+      }
+      memset(slots[i], 0xc3, size);
+      sizes[i] = size;
+      liveBytes += size;
+    }
+    report("refilled", liveBytes);
+  }
+
+  for (int i = 0; i < nslots; i++) {
+    if (slots[i]) {
+      myFree(slots[i]);
+      liveBytes -= sizes[i];
+    }
+  }
+  report("drained", liveBytes);
+
+  free(sizes);
+  free(slots);
+  return 0;
+}
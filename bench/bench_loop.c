@@ -0,0 +1,108 @@
+/*
+ * Throughput scaling benchmark: each pinned thread runs an independent
+ * alloc/free loop over a configurable size distribution. Thread counts are
+ * doubled from 1 up to the requested maximum, each measured in a forked
+ * child so the reported RSS is not polluted by earlier rounds.
+ *
+ * usage: bench_loop [max_threads] [ops_per_thread] [distribution]
+ *   distribution: small | large | mixed | min:max   (default mixed)
+ */
+#include <sys/wait.h>
+
+#include "bench.h"
+#include "my_malloc.h"
+
+#define LIVE_SLOTS 512
+
+static int opsPerThread = 1000000;
+static const char *dist = "mixed";
+
+typedef struct {
+  int id;
+  uint64_t ops;
+} WorkerArg;
+
+static void *worker(void *p) {
+  WorkerArg *arg = p;
+  bench_pin(arg->id);
+
+  void *slots[LIVE_SLOTS] = {0};
+  uint64_t rng = 0x9e3779b97f4a7c15ull ^ (arg->id + 1);
+
+  for (int i = 0; i < opsPerThread; i++) {
+    int s = bench_rand(&rng) % LIVE_SLOTS;
+    if (slots[s]) {
+      myFree(slots[s]);
+      slots[s] = NULL;
+    } else {
+      slots[s] = myMalloc(bench_size(dist, &rng));
+      if (!slots[s]) {
+        fprintf(stderr, "myMalloc failed\n");
+        exit(1);
+      }
+      memset(slots[s], 0xa5, 8);
+    }
+  }
+
+  for (int s = 0; s < LIVE_SLOTS; s++) {
+    if (slots[s]) {
+      myFree(slots[s]);
+    }
+  }
+
+  arg->ops = opsPerThread;
+  return NULL;
+}
+
+static void run_round(int nthreads) {
+  pthread_t threads[nthreads];
+  WorkerArg args[nthreads];
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < nthreads; i++) {
+    args[i].id = i;
+    pthread_create(&threads[i], NULL, worker, &args[i]);
+  }
+
+  uint64_t total = 0;
+  for (int i = 0; i < nthreads; i++) {
+    pthread_join(threads[i], NULL);
+    total += args[i].ops;
+  }
+  uint64_t elapsed = bench_now_ns() - start;
+
+  printf("%8d %14.0f %12ld\n", nthreads,
+         total / (elapsed / 1e9), bench_rss_kb());
+}
+
+int main(int argc, char **argv) {
+  int maxThreads = argc > 1 ? atoi(argv[1]) : 8;
+  if (argc > 2) {
+    opsPerThread = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    dist = argv[3];
+  }
+
+  printf("bench_loop: dist=%s ops/thread=%d\n", dist, opsPerThread);
+  printf("%8s %14s %12s\n", "threads", "ops/sec", "rss_kb");
+
+  for (int n = 1; n <= maxThreads; n *= 2) {
+    // Fork per round so each RSS sample starts from a fresh heap.
+    // Flush so the buffered header is not replayed by the child.
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      run_round(n);
+      exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "round with %d threads failed\n", n);
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Producer/consumer benchmark: producer threads allocate blocks and hand
+ * them through single-producer single-consumer rings to paired consumer
+ * threads, which free them. Every block is freed by a different thread
+ * than the one that allocated it, which is the worst case for per-arena
+ * locking and the case the remote-free queues are built for.
+ *
+ * usage: bench_pipeline [max_pairs] [blocks_per_pair] [distribution]
+ */
+#include <stdatomic.h>
+#include <sys/wait.h>
+
+#include "bench.h"
+#include "my_malloc.h"
+
+#define RING_SIZE 1024
+
+static int blocksPerPair = 1000000;
+static const char *dist = "mixed";
+
+typedef struct {
+  void *ring[RING_SIZE];
+  atomic_uint head; // next slot the producer writes
+  atomic_uint tail; // next slot the consumer reads
+  int id;
+} Pipe;
+
+static void *producer(void *p) {
+  Pipe *pipe = p;
+  bench_pin(2 * pipe->id);
+  uint64_t rng = 0x9e3779b97f4a7c15ull ^ (pipe->id + 1);
+
+  for (int i = 0; i < blocksPerPair; i++) {
+    void *block = myMalloc(bench_size(dist, &rng));
+    if (!block) {
+      fprintf(stderr, "myMalloc failed\n");
+      exit(1);
+    }
+    memset(block, 0x5a, 8);
+
+    unsigned head = atomic_load_explicit(&pipe->head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&pipe->tail, memory_order_acquire)
+           == RING_SIZE) {
+      sched_yield();
+    }
+    pipe->ring[head % RING_SIZE] = block;
+    atomic_store_explicit(&pipe->head, head + 1, memory_order_release);
+  }
+  return NULL;
+}
+
+static void *consumer(void *p) {
+  Pipe *pipe = p;
+  bench_pin(2 * pipe->id + 1);
+
+  for (int i = 0; i < blocksPerPair; i++) {
+    unsigned tail = atomic_load_explicit(&pipe->tail, memory_order_relaxed);
+    while (atomic_load_explicit(&pipe->head, memory_order_acquire) == tail) {
+      sched_yield();
+    }
+    myFree(pipe->ring[tail % RING_SIZE]);
+    atomic_store_explicit(&pipe->tail, tail + 1, memory_order_release);
+  }
+  return NULL;
+}
+
+static void run_round(int pairs) {
+  pthread_t producers[pairs];
+  pthread_t consumers[pairs];
+  Pipe *pipes = calloc(pairs, sizeof(Pipe));
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < pairs; i++) {
+    pipes[i].id = i;
+    pthread_create(&producers[i], NULL, producer, &pipes[i]);
+    pthread_create(&consumers[i], NULL, consumer, &pipes[i]);
+  }
+  for (int i = 0; i < pairs; i++) {
+    pthread_join(producers[i], NULL);
+    pthread_join(consumers[i], NULL);
+  }
+  uint64_t elapsed = bench_now_ns() - start;
+
+  // One op = one cross-thread malloc/free round trip.
+  printf("%8d %14.0f %12ld\n", pairs,
+         (uint64_t)pairs * blocksPerPair / (elapsed / 1e9), bench_rss_kb());
+  free(pipes);
+}
+
+int main(int argc, char **argv) {
+  int maxPairs = argc > 1 ? atoi(argv[1]) : 4;
+  if (argc > 2) {
+    blocksPerPair = atoi(argv[2]);
+  }
+  if (argc > 3) {
+    dist = argv[3];
+  }
+
+  printf("bench_pipeline: dist=%s blocks/pair=%d\n", dist, blocksPerPair);
+  printf("%8s %14s %12s\n", "pairs", "ops/sec", "rss_kb");
+
+  for (int n = 1; n <= maxPairs; n *= 2) {
+    // Flush so the buffered header is not replayed by the child.
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      run_round(n);
+      exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "round with %d pairs failed\n", n);
+      return 1;
+    }
+  }
+
+  return 0;
+}
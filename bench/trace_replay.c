@@ -0,0 +1,136 @@
+/*
+ * Trace replayer: mmaps a binary trace recorded by a build with
+ * -DMALLOC_TRACE and re-executes it against the allocator, reporting
+ * ops/sec and RSS. Recorded pointers are mapped to this run's pointers
+ * through an open-addressing hash table, so a captured production
+ * workload becomes a repeatable benchmark.
+ *
+ * Records are replayed sequentially in file order (the order the
+ * per-thread buffers were flushed), which preserves each thread's
+ * ordering but serializes cross-thread timing. Build this binary
+ * without -DMALLOC_TRACE or the replay will trace itself.
+ *
+ * usage: trace_replay <trace_file>
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bench.h"
+#include "my_malloc.h"
+
+typedef struct {
+  uint64_t key; // recorded pointer, 0 = empty slot
+  void *val;    // live pointer in this run
+} MapEntry;
+
+static MapEntry *map;
+static size_t mapMask;
+
+static size_t map_slot(uint64_t key) {
+  size_t slot = (key * 0x9e3779b97f4a7c15ull) & mapMask;
+  while (map[slot].key != 0 && map[slot].key != key) {
+    slot = (slot + 1) & mapMask;
+  }
+  return slot;
+}
+
+static void map_put(uint64_t key, void *val) {
+  size_t slot = map_slot(key);
+  map[slot].key = key;
+  map[slot].val = val;
+}
+
+/* Remove by marking the value dead; keys stay so probing still works. */
+static void *map_take(uint64_t key) {
+  size_t slot = map_slot(key);
+  void *val = map[slot].val;
+  map[slot].val = NULL;
+  return map[slot].key == key ? val : NULL;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <trace_file>\n", argv[0]);
+    return 1;
+  }
+
+  int fd = open(argv[1], O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  size_t nrecords = st.st_size / sizeof(TraceRecord);
+  TraceRecord *records = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (records == MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+
+  // Size the pointer map to keep the load factor below one half even if
+  // every record allocated.
+  size_t capacity = 16;
+  while (capacity < 2 * nrecords + 1) {
+    capacity *= 2;
+  }
+  mapMask = capacity - 1;
+  map = calloc(capacity, sizeof(MapEntry));
+
+  size_t skipped = 0;
+  uint64_t start = bench_now_ns();
+
+  for (size_t i = 0; i < nrecords; i++) {
+    TraceRecord *rec = &records[i];
+    switch (rec->op) {
+      case TRACE_MALLOC:
+      case TRACE_CALLOC: {
+        void *mem = rec->op == TRACE_MALLOC ? myMalloc(rec->size)
+                                            : myCalloc(1, rec->size);
+        if (rec->result) {
+          map_put(rec->result, mem);
+        }
+        break;
+      }
+      case TRACE_REALLOC: {
+        void *old = rec->ptr ? map_take(rec->ptr) : NULL;
+        if (rec->ptr && !old) {
+          skipped++;
+          break;
+        }
+        void *mem = myRealloc(old, rec->size);
+        if (rec->result) {
+          map_put(rec->result, mem);
+        }
+        break;
+      }
+      case TRACE_FREE: {
+        if (!rec->ptr) {
+          myFree(NULL);
+          break;
+        }
+        void *mem = map_take(rec->ptr);
+        if (mem) {
+          myFree(mem);
+        } else {
+          // Frees of blocks allocated before tracing started (or by a
+          // thread whose buffer was lost) cannot be replayed.
+          skipped++;
+        }
+        break;
+      }
+      default:
+        fprintf(stderr, "corrupt record %zu (op %u)\n", i, rec->op);
+        return 1;
+    }
+  }
+
+  uint64_t elapsed = bench_now_ns() - start;
+  printf("replayed %zu records (%zu skipped) in %.3fs: %.0f ops/sec, rss %ld kB\n",
+         nrecords, skipped, elapsed / 1e9,
+         nrecords / (elapsed / 1e9), bench_rss_kb());
+
+  free(map);
+  return 0;
+}
@@ -1,11 +1,18 @@
 #include <errno.h>
 #include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#ifdef MALLOC_NUMA
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
 #include "my_malloc.h"
 #include "printing.h"
 
@@ -25,27 +32,410 @@ static inline void assert(int e) {
   #include <assert.h>
 #endif
 
-// Mutex to ensure thread safety for the freelist.
-static pthread_mutex_t mutex;
-
-// Array of sentinel nodes for the freelists.
-Header freelists[NUM_LISTS];
-
 /*
- * Pointer to the second fencepost in the most recently allocated chunk from the OS.
- * Used for coalescing chunks.
+ * An arena groups the state a thread needs on the allocation fast path:
+ * an array of freelist sentinels, the mutex guarding them, and the second
+ * fencepost of the most recently allocated chunk (used for coalescing
+ * chunks). With MALLOC_ARENAS == 1 (the default) there is a single arena
+ * and the allocator behaves exactly as before.
  */
-Header *lastFencepost;
+typedef struct _Arena {
+	// Mutex to ensure thread safety for the freelists.
+	pthread_mutex_t mutex;
+	// Array of sentinel nodes for the freelists.
+	FreeList *freelists;
+	// Bitmap with one bit per freelist, set while the list is non-empty.
+	char *freelistBitmap;
+	/*
+	 * Pointer to the second fencepost in the most recently allocated chunk
+	 * from the OS. Used for coalescing chunks.
+	 */
+	Header *lastFencepost;
+	// Size of the next chunk to request from the OS.
+	size_t nextChunkSize;
+	// Runtime counters, updated under the arena mutex.
+	MallocStats stats;
+	// Bytes sitting on each freelist, maintained by the insert, remove,
+	// and in-place resize paths so occupancy queries need no heap walk.
+	size_t freeBytesByClass[NUM_LISTS];
+#if MALLOC_ARENAS > 1
+	/*
+	 * Lock-free MPSC stack of blocks freed by threads that do not own this
+	 * arena. Producers push with a CAS and never touch the arena mutex; the
+	 * owner drains the stack at the top of allocObject while it already
+	 * holds the mutex. Blocks on the stack are still ALLOCATED and are
+	 * linked through the next field of their (now unused) data area.
+	 */
+	Header *remoteFrees;
+#endif
+#ifdef MALLOC_DEFERRED
+	/*
+	 * Stack of deferred frees. Building with -DMALLOC_DEFERRED makes myFree
+	 * push the block here untouched instead of coalescing eagerly; the
+	 * blocks are coalesced in one batch by myMallocConsolidate, which runs
+	 * on an allocation miss or when called explicitly. Deferred blocks stay
+	 * ALLOCATED and are linked through the next field of their data area,
+	 * like dlmalloc's fastbins. Note: a deferred block defeats the
+	 * double-free check in deallocObject until it is consolidated.
+	 */
+	Header *quickList;
+#endif
+#ifdef MALLOC_BESTFIT
+	// Root of the size-keyed trie indexing the overflow freelist.
+	Header *trieRoot;
+#endif
+}
+#ifdef MALLOC_PADDED
+// Keep each arena's mutex and hot metadata on their own cache lines.
+__attribute__((aligned(CACHE_LINE_SIZE)))
+#endif
+Arena;
+
+static Arena arenas[MALLOC_ARENAS];
+
+// Sentinel storage for the primary arena, kept global so the printing and
+// verification code can keep walking the freelists directly.
+FreeList freelists[NUM_LISTS];
+
+// Bitmap of non-empty freelists for the primary arena, one bit per list.
+char freelistBitmap[(NUM_LISTS + 7) / 8];
+
+#if MALLOC_ARENAS > 1
+// Sentinel storage for the additional arenas.
+static FreeList extraFreelists[MALLOC_ARENAS - 1][NUM_LISTS];
+// Non-empty freelist bitmaps for the additional arenas.
+static char extraFreelistBitmaps[MALLOC_ARENAS - 1][(NUM_LISTS + 7) / 8];
+// Round-robin counter used to assign threads to arenas.
+static size_t nextArena;
+// Arena owned by the current thread, assigned on first allocation.
+static __thread Arena *threadArena;
+#endif
 
 /*
  * Pointer to maintian the base of the heap to allow printing based on the
  * distance from the base of the heap.
- */ 
+ */
 void *base;
 
-// List of chunks allocated by the OS for printing boundary tags.
-Header *chunkList[MAX_NUM_CHUNKS];
+/*
+ * Address-sorted index of chunks allocated by the OS, used for printing
+ * boundary tags and for mapping a pointer to its owning chunk. sbrk
+ * hands out ascending addresses, so keeping the index sorted is an
+ * append in practice; the insertion path still handles out-of-order
+ * entries so the invariant never depends on it. The index starts in the
+ * static array below and grows by doubling with memory taken straight
+ * from sbrk (the bookkeeping cannot feed back through the freelists it
+ * serves), so tracked heaps are no longer capped at MAX_NUM_CHUNKS.
+ */
+static Header *initialChunkList[MAX_NUM_CHUNKS];
+Header **chunkList = initialChunkList;
 size_t numChunks = 0;
+static size_t chunkCapacity = MAX_NUM_CHUNKS;
+
+// Mutex serializing sbrk and the chunk bookkeeping shared by all arenas.
+static pthread_mutex_t chunkMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Counters with no owning arena: chunk requests are serialized by
+// chunkMutex and mmap allocations take no lock at all.
+static size_t statChunks;
+static size_t statMmaps;
+// Bytes obtained from the OS for chunks, updated under chunkMutex.
+static size_t statHeapBytes;
+
+#ifdef MALLOC_VALIDATE
+// One past the end of the highest chunk, updated under chunkMutex. Every
+// block lives below it and everything between the chunk index and it is
+// mapped, so validated header reads cannot fault.
+static void *heapEnd;
+#endif
+
+/*
+ * Emergency reserve: one chunk of raw memory set aside at startup, below
+ * the first chunk and invisible to the chunk index until needed. The
+ * first time the OS refuses more memory the reserve is donated to the
+ * freelists of the arena that hit the wall, so a long-running process at
+ * its limit can still allocate enough to log and shed load before
+ * myMalloc starts returning NULL.
+ */
+static void *emergencyReserve;
+
+#if MALLOC_ARENAS > 1
+// Arena owning each chunk in chunkList, used to route frees to the arena
+// whose freelists hold the block's neighbors. Grown in step with chunkList.
+static Arena *initialChunkArenas[MAX_NUM_CHUNKS];
+static Arena **chunkArenas = initialChunkArenas;
+#endif
+
+#ifdef MALLOC_BESTFIT
+/*
+ * Building with -DMALLOC_BESTFIT replaces the linear first-fit scan of the
+ * overflow freelist with a bitwise trie keyed on getSize, giving O(log n)
+ * best-fit lookup for blocks of 488+ bytes of payload. Overflow blocks
+ * stay linked into freelists[NUM_LISTS - 1] as well so the printing and
+ * verification code keep working; the trie node lives in the unused data
+ * area past the freelist pointers (overflow blocks are always large
+ * enough to hold it). Blocks of equal size share one tree node and hang
+ * off it in a circular ring.
+ */
+typedef struct _TrieNode {
+	// Children holding sizes whose next key bit is 0 or 1.
+	struct _Header *child[2];
+	// Pointer to the slot referencing this node (root or a child slot).
+	// NULL marks a block that is only a member of a same-size ring.
+	struct _Header **parentLink;
+	// Circular ring of blocks with the same size.
+	struct _Header *sameNext;
+	struct _Header *samePrev;
+} TrieNode;
+
+// Highest key bit examined when descending the trie.
+#define TRIE_START_BIT 62
+
+static inline TrieNode *trieNode(Header *hdr)
+{
+	return (TrieNode *)((char *)hdr + UNALLOC_HEADER_SIZE);
+}
+#endif
+
+#ifdef MALLOC_MAGAZINES
+#ifndef MAGAZINE_SIZE
+// Maximum number of blocks a thread caches per size class.
+#define MAGAZINE_SIZE 32
+#endif
+/*
+ * Thread-local per-size-class stacks of recently freed blocks (magazines).
+ * myMalloc pops and myFree pushes with no locking or atomics; half of a
+ * magazine is spilled to the locked freelists when it overflows. Cached
+ * blocks stay ALLOCATED so their neighbors are never coalesced with them,
+ * and the link to the next cached block is stored in the unused data area.
+ * Note: a block cached in a magazine defeats the double-free check in
+ * deallocObject until it is spilled. Non-static so the myMallocFixed
+ * inline fast path in the header can pop from them.
+ */
+__thread Header *magazines[NUM_LISTS - 1];
+__thread int magazineCounts[NUM_LISTS - 1];
+#endif
+
+#ifdef MALLOC_DECOMMIT
+#ifndef DECOMMIT_THRESHOLD
+/*
+ * Retention policy knob: only free blocks at least this large have their
+ * interior returned to the OS. Raising it keeps more memory resident for
+ * hot workloads that would otherwise thrash on re-faulting pages;
+ * lowering it returns memory more aggressively.
+ */
+#define DECOMMIT_THRESHOLD (16 * 4096)
+#endif
+#endif
+
+#ifdef MALLOC_TRACE
+#ifndef TRACE_BUFFER_RECORDS
+// Number of records a thread buffers before flushing to the trace file.
+#define TRACE_BUFFER_RECORDS 4096
+#endif
+
+#include <fcntl.h>
+
+/*
+ * Building with -DMALLOC_TRACE logs every public myMalloc, myCalloc,
+ * myRealloc, and myFree call into a per-thread record buffer that is
+ * flushed to the trace file when full and when the thread or process
+ * exits. The public entry points below are renamed to untraced internals
+ * and thin traced wrappers are defined at the end of the file, so the
+ * inner myMalloc/myFree calls made by calloc and realloc produce no
+ * records of their own and the trace holds one record per logical call.
+ * Trace buffers come straight from mmap so tracing never disturbs the
+ * heap being traced.
+ */
+typedef struct {
+	TraceRecord records[TRACE_BUFFER_RECORDS];
+	size_t count;
+	uint16_t tid;
+} TraceBuffer;
+
+static int traceFd = -1;
+// Serializes opening the trace file; writes are O_APPEND and atomic.
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t traceKey;
+static pthread_once_t traceOnce = PTHREAD_ONCE_INIT;
+// Next thread id to hand out, in order of first traced call.
+static size_t nextTraceTid;
+static __thread TraceBuffer *traceBuffer;
+
+static void _traceFlush(TraceBuffer *buf)
+{
+	if (buf -> count == 0)
+		return;
+
+	pthread_mutex_lock(&traceMutex);
+	if (traceFd < 0) {
+		const char *path = getenv("MALLOC_TRACE_FILE");
+		traceFd = open(path != NULL ? path : "my_malloc.trace",
+				O_WRONLY | O_CREAT | O_APPEND, 0644);
+	}
+	pthread_mutex_unlock(&traceMutex);
+
+	if (traceFd >= 0)
+		write(traceFd, buf -> records, buf -> count * sizeof(TraceRecord));
+	buf -> count = 0;
+}
+
+// Key destructor: flush and release a thread's buffer when it exits.
+static void _traceDestroy(void *ptr)
+{
+	TraceBuffer *buf = ptr;
+
+	_traceFlush(buf);
+	munmap(buf, sizeof(TraceBuffer));
+}
+
+// The main thread's key destructor never runs; flush from atexit instead.
+static void _traceAtExit()
+{
+	if (traceBuffer != NULL)
+		_traceFlush(traceBuffer);
+}
+
+static void _traceInit()
+{
+	pthread_key_create(&traceKey, _traceDestroy);
+	atexit(_traceAtExit);
+}
+
+static void _traceRecord(uint16_t op, size_t size, void *ptr, void *result)
+{
+	pthread_once(&traceOnce, _traceInit);
+
+	if (traceBuffer == NULL) {
+		void *mem = mmap(NULL, sizeof(TraceBuffer), PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED)
+			return;
+
+		traceBuffer = mem;
+		traceBuffer -> tid = (uint16_t)__atomic_fetch_add(&nextTraceTid, 1, __ATOMIC_RELAXED);
+		pthread_setspecific(traceKey, traceBuffer);
+	}
+
+	TraceRecord *rec = &traceBuffer -> records[traceBuffer -> count++];
+	rec -> op = op;
+	rec -> tid = traceBuffer -> tid;
+	rec -> unused = 0;
+	rec -> size = size;
+	rec -> ptr = (uintptr_t)ptr;
+	rec -> result = (uintptr_t)result;
+
+	if (traceBuffer -> count == TRACE_BUFFER_RECORDS)
+		_traceFlush(traceBuffer);
+}
+
+// Rename the public entry points defined below to untraced internals;
+// the traced wrappers at the end of the file take their public names.
+#define myMalloc _myMallocUntraced
+#define myCalloc _myCallocUntraced
+#define myRealloc _myReallocUntraced
+#define myFree _myFreeUntraced
+
+// Forward declarations of the renamed internals for their cross-calls
+// (realloc calls malloc and free before free is defined).
+void *myMalloc(size_t size);
+void myFree(void *ptr);
+#endif
+
+#ifdef MALLOC_PROFILE
+#ifndef PROFILE_INTERVAL
+// Mean number of allocated bytes between samples
+#define PROFILE_INTERVAL (512 * 1024)
+#endif
+// Frames kept per sample, after dropping the allocator's own two
+#define PROFILE_DEPTH 16
+// Capacity of the preallocated sample buffer
+#define PROFILE_MAX_SAMPLES 4096
+
+#include <execinfo.h>
+
+/*
+ * Building with -DMALLOC_PROFILE samples the allocation stream: roughly
+ * every PROFILE_INTERVAL-th byte allocated, myMalloc records the
+ * requested size and the caller's return address chain into a
+ * preallocated buffer. myHeapProfileDump writes the buffer in the
+ * legacy pprof heap format with the process mappings appended for
+ * symbolization, so footprint growth can be attributed to call sites
+ * statistically. Between samples the fast path pays two branches and a
+ * subtraction; the per-thread countdown is jittered uniformly around
+ * the interval so periodic allocation patterns cannot dodge the
+ * sampler.
+ */
+typedef struct {
+	// Requested size of the sampled allocation
+	size_t size;
+	// Return address chain, innermost caller first
+	void *stack[PROFILE_DEPTH];
+	int depth;
+} ProfileSample;
+
+static ProfileSample profileSamples[PROFILE_MAX_SAMPLES];
+static size_t numProfileSamples;
+static pthread_mutex_t profileMutex = PTHREAD_MUTEX_INITIALIZER;
+// Bytes left until the calling thread's next sample.
+static __thread size_t profileCountdown;
+static __thread uint64_t profileRngState;
+
+// xorshift64: cheap thread-local randomness for the countdown jitter.
+static uint64_t _profileRng()
+{
+	if (profileRngState == 0)
+		profileRngState = (uint64_t)(uintptr_t)&profileRngState | 1;
+	profileRngState ^= profileRngState << 13;
+	profileRngState ^= profileRngState >> 7;
+	profileRngState ^= profileRngState << 17;
+	return profileRngState;
+}
+
+/*
+ * @brief Record one sample: the size and the caller's stack.
+ *
+ * backtrace may take libc's own allocator on first use, which is fine
+ * here: no arena mutex is held on this path.
+ *
+ * @param size the requested size of the sampled allocation
+ */
+static void _profileRecord(size_t size)
+{
+	void *frames[PROFILE_DEPTH + 2];
+	int depth = backtrace(frames, PROFILE_DEPTH + 2);
+
+	// Drop the two innermost frames (this function and myMalloc) so the
+	// chain starts at the allocation site.
+	depth = depth > 2 ? depth - 2 : 0;
+
+	pthread_mutex_lock(&profileMutex);
+	if (numProfileSamples < PROFILE_MAX_SAMPLES) {
+		ProfileSample *sample = &profileSamples[numProfileSamples++];
+		sample -> size = size;
+		sample -> depth = depth;
+		memcpy(sample -> stack, frames + 2, depth * sizeof(void *));
+	}
+	pthread_mutex_unlock(&profileMutex);
+}
+
+/*
+ * @brief Count an allocation against the calling thread's countdown.
+ *
+ * @param size the requested size in bytes
+ */
+static inline void _profileSample(size_t size)
+{
+	if (profileCountdown > size) {
+		profileCountdown -= size;
+		return;
+	}
+
+	_profileRecord(size);
+	// Draw the next countdown uniformly in [interval/2, 3*interval/2).
+	profileCountdown = PROFILE_INTERVAL / 2 + _profileRng() % PROFILE_INTERVAL;
+}
+#endif
 
 /*
  * Direct the compiler to run the init function before running main.
@@ -60,14 +450,28 @@ static inline Header *ptrToHeader(void *ptr);
 
 // Helper functions for allocating more memory from the OS.
 static inline void initFencepost(Header *fp, size_t leftSize);
-static inline void insertChunk(Header *hdr);
+static inline void insertChunk(Arena *arena, Header *hdr);
 static inline void insertFenceposts(void *rawMem, size_t size);
 static Header *allocChunk(size_t size);
 
+// Helper functions for mapping threads and blocks to arenas.
+static inline Arena *getArena();
+#if MALLOC_ARENAS > 1
+static Arena *findBlockArena(Header *hdr);
+#endif
+
 // Helper function for freeing a block.
-static inline void deallocObject(void *ptr);
+static inline void deallocObject(Arena *arena, void *ptr);
 // Helper function for allocating a block.
-static inline Header *allocObject(size_t rawSize);
+static inline Header *allocObject(Arena *arena, size_t rawSize);
+// Helper function for allocating a large block directly from the OS.
+static Header *mmapObject(size_t actualSize);
+#ifdef MALLOC_VALIDATE
+// Helper functions for vetting pointers before their headers are read.
+static bool _validPointer(void *ptr);
+static void _registerMmap(Header *hdr);
+static void _unregisterMmap(Header *hdr);
+#endif
 
 // Helper functions for verifying that the data structures are structurally valid.
 static inline Header *detectCycles();
@@ -82,15 +486,31 @@ static bool isMallocInitialized;
 
 // My Helpder functions for allocating and deallocating memory.
 // @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
-static size_t _calcActualSize(size_t rawSize);
-static int _getFreelistIndex(size_t actualSize);
-static void *_coalesceChunks(Header *prevBlock, Header *currBlock);
-static Header *_allocBlock(int index, size_t actualSize);
+static void *_coalesceChunks(Arena *arena, Header *prevBlock, Header *currBlock);
+static Header *_allocBlock(Arena *arena, int index, size_t actualSize);
 static bool _isEmptyFreelist(Header *hdr);
 static bool _isSameIndex(int one, int other);
-static void _updateBlock(Header *hdr);
-static void _insertBlock(Header *hdr);
-static void _removeBlock(Header *hdr);
+static Header *_takeBlock(Arena *arena, Header *curr, int index, size_t actualSize);
+static bool _needsRehome(int oldIndex, int newIndex);
+static void _updateBlock(Arena *arena, Header *hdr, int oldIndex);
+static void _insertBlock(Arena *arena, Header *hdr);
+static void _removeBlock(Arena *arena, Header *hdr, int index);
+#ifdef MALLOC_BESTFIT
+static void _trieInsert(Arena *arena, Header *hdr);
+static void _trieRemove(Arena *arena, Header *hdr);
+static Header *_trieBestFit(Arena *arena, size_t actualSize);
+#endif
+static void _setBitmap(Arena *arena, int index);
+static void _clearBitmap(Arena *arena, int index);
+static int _nextNonEmptyList(Arena *arena, int index);
+static void _freeToArena(void *ptr);
+#ifdef MALLOC_DEFERRED
+static void _consolidateArena(Arena *arena);
+#endif
+static bool _reallocInPlace(Arena *arena, Header *hdr, size_t actualSize);
+#ifdef MALLOC_MAGAZINES
+static void _spillMagazine(int index);
+#endif
 // @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 
 /*
@@ -128,8 +548,139 @@ Header *getRightHeader(Header *hdr)
  */
 static inline Header *getLeftHeader(Header *hdr)
 {
+#ifdef MALLOC_FOOTERS
+	// Only valid while the left neighbor is free; callers check the
+	// left-free flag first.
+	return getHeaderFromOffset(hdr, -(*((size_t *)hdr - 1)));
+#else
 	return getHeaderFromOffset(hdr, -(hdr -> leftSize));
+#endif
+}
+
+#ifdef MALLOC_FOOTERS
+/*
+ * @brief Read the footer of the block to the left of a header.
+ *
+ * The footer is the last word of the left block, which sits just below
+ * this header. It holds the left block's size and is valid only while
+ * that block is free.
+ *
+ * @param hdr the header whose left neighbor's footer to read
+ *
+ * @return The size recorded in the footer
+ */
+static inline size_t _getFooter(Header *hdr)
+{
+	return *((size_t *)hdr - 1);
+}
+
+/*
+ * @brief Publish a block's boundary tag to its right neighbor.
+ *
+ * A free block writes its size into its footer and raises the neighbor's
+ * left-free flag; an allocated block just lowers the flag, handing the
+ * footer word over to its user data. Called whenever a block's size or
+ * state settles, in place of the leftSize updates of the default layout.
+ *
+ * @param hdr the block whose size and state are final
+ */
+static inline void _publishBlock(Header *hdr)
+{
+	Header *right = getRightHeader(hdr);
+
+	if (getState(hdr) == UNALLOCATED) {
+		*((size_t *)right - 1) = getSize(hdr);
+		setLeftFree(right, true);
+	} else {
+		setLeftFree(right, false);
+	}
+}
+#endif
+
+#ifdef MALLOC_HARDEN
+/*
+ * Hardened mode. Building with -DMALLOC_HARDEN reserves CANARY_SIZE
+ * bytes at the end of every block, stamped with a known pattern on
+ * allocation and verified when the block is freed, together with a
+ * boundary-tag cross-check against both neighbors. The canary region is
+ * a multiple of 32 bytes so the bulk check in verifyChunk compares whole
+ * vector registers instead of chasing single words.
+ */
+#define CANARY_WORD ((size_t)0xDEADBEEFCAFEBABE)
+
+/*
+ * @brief Stamp the trailing canary of an allocated block.
+ *
+ * @param hdr the header of the block
+ */
+static inline void _stampCanary(Header *hdr)
+{
+	size_t *canary = (size_t *)((char *)hdr + getSize(hdr) - CANARY_SIZE);
+
+	for (size_t i = 0; i < CANARY_SIZE / sizeof(size_t); i++)
+		canary[i] = CANARY_WORD;
+}
+
+/*
+ * @brief Check the trailing canary of an allocated block.
+ *
+ * The words are combined into one accumulated difference and tested
+ * once, so the compiler can issue the comparison as 32-byte vector ops.
+ *
+ * @param hdr the header of the block
+ *
+ * @return true if the canary pattern is intact
+ */
+static inline bool _canaryIntact(Header *hdr)
+{
+	size_t *canary = (size_t *)((char *)hdr + getSize(hdr) - CANARY_SIZE);
+	size_t diff = 0;
+
+	for (size_t i = 0; i < CANARY_SIZE / sizeof(size_t); i++)
+		diff |= canary[i] ^ CANARY_WORD;
+
+	return diff == 0;
+}
+
+/*
+ * @brief Validate a block's canary and boundary tags before freeing it.
+ *
+ * The leftSize bound is checked before the left neighbor is read, so a
+ * header smashed with garbage is reported instead of faulting on a wild
+ * dereference.
+ *
+ * @param hdr the header of the block being freed
+ */
+static void _verifyHardened(Header *hdr)
+{
+	bool valid = _canaryIntact(hdr);
+
+	if (valid && getState(hdr) != MMAPPED) {
+		if (hdr -> leftSize > (size_t)((char *)hdr - (char *)base) ||
+				getSize(getLeftHeader(hdr)) != hdr -> leftSize ||
+				getRightHeader(hdr) -> leftSize != getSize(hdr))
+			valid = false;
+	}
+
+	if (!valid) {
+		fprintf(stderr, "Memory Corruption Detected\n");
+		fprintf(stderr, "Assertion Failed!\n");
+		exit(1);
+	}
 }
+#endif
+
+/*
+ * Minimum leftover the aligned-allocation and realloc split paths give
+ * back as a standalone free block. Hardened builds need room for the
+ * trailing canary beyond the leftover's own header, or stamping it
+ * would overwrite the header.
+ */
+#ifdef MALLOC_HARDEN
+#define MIN_SPLIT_SIZE (UNALLOC_HEADER_SIZE + CANARY_SIZE)
+#else
+#define MIN_SPLIT_SIZE MIN_BLOCK_SIZE
+#endif
 
 /*
  * @brief Fenceposts are marked as always allocated and may need to have
@@ -142,18 +693,98 @@ static inline void initFencepost(Header *fp, size_t leftSize)
 {
 	setState(fp, FENCEPOST);
 	setSize(fp, ALLOC_HEADER_SIZE);
+#ifdef MALLOC_FOOTERS
+	// A free left neighbor publishes its footer under the fencepost later.
+	(void)leftSize;
+#else
 	fp -> leftSize = leftSize;
+#endif
 }
 
 /*
- * @brief Helper function to maintain list of chunks from the OS for debugging.
+ * @brief Helper function to maintain list of chunks from the OS for debugging
+ * and for mapping blocks back to their owning arena.
  *
+ * @param arena the arena the chunk was allocated for
  * @param hdr the first fencepost in the chunk allocated by the OS
  */
-static inline void insertChunk(Header *hdr) 
+static inline void insertChunk(Arena *arena, Header *hdr)
+{
+	pthread_mutex_lock(&chunkMutex);
+	if (numChunks == chunkCapacity) {
+		// Double the index, taking storage directly from sbrk: chunkMutex
+		// is already held and the freelists cannot serve their own
+		// bookkeeping. The old arrays are abandoned; doubling keeps the
+		// total waste below the size of the live index.
+		size_t newCapacity = 2 * chunkCapacity;
+		Header **newList = sbrk(newCapacity * sizeof(Header *));
+#if MALLOC_ARENAS > 1
+		// Each sbrk can fail on its own once the break cannot grow; commit
+		// neither array unless both succeeded so the index stays usable at
+		// its old capacity.
+		Arena **newArenas = sbrk(newCapacity * sizeof(Arena *));
+		if (newList != (void *)-1 && newArenas != (void *)-1) {
+#else
+		if (newList != (void *)-1) {
+#endif
+			memcpy(newList, chunkList, numChunks * sizeof(Header *));
+			chunkList = newList;
+#if MALLOC_ARENAS > 1
+			memcpy(newArenas, chunkArenas, numChunks * sizeof(Arena *));
+			chunkArenas = newArenas;
+#endif
+			chunkCapacity = newCapacity;
+		}
+	}
+	if (numChunks < chunkCapacity) {
+		// Keep the index address-sorted; sbrk's monotonic growth makes
+		// this a plain append except after out-of-order insertions.
+		size_t pos = numChunks;
+		while (pos > 0 && chunkList[pos - 1] > hdr) {
+			chunkList[pos] = chunkList[pos - 1];
+#if MALLOC_ARENAS > 1
+			chunkArenas[pos] = chunkArenas[pos - 1];
+#endif
+			pos--;
+		}
+#if MALLOC_ARENAS > 1
+		chunkArenas[pos] = arena;
+#else
+		(void)arena;
+#endif
+		chunkList[pos] = hdr;
+		numChunks++;
+	}
+	pthread_mutex_unlock(&chunkMutex);
+}
+
+/*
+ * @brief Find the index of the chunk owning a pointer.
+ *
+ * Binary search over the address-sorted index for the greatest chunk
+ * start at or below the pointer. Called with chunkMutex held.
+ *
+ * @param ptr a pointer into some chunk
+ *
+ * @return The index of the owning chunk, or -1 if ptr precedes the heap
+ */
+static ssize_t findChunkIndex(void *ptr)
 {
-	if (numChunks < MAX_NUM_CHUNKS) 
-		chunkList[numChunks++] = hdr;
+	ssize_t low = 0;
+	ssize_t high = (ssize_t)numChunks - 1;
+	ssize_t best = -1;
+
+	while (low <= high) {
+		ssize_t mid = (low + high) / 2;
+		if ((void *)chunkList[mid] <= ptr) {
+			best = mid;
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+
+	return best;
 }
 
 /*
@@ -178,62 +809,243 @@ static inline void insertFenceposts(void *rawMem, size_t size)
   	initFencepost(rightFencepost, size - 2 * ALLOC_HEADER_SIZE);
 }
 
+#ifdef MALLOC_HUGEPAGES
+#ifndef HUGE_PAGE_SIZE
+// Huge page size assumed when asking the kernel to back a span with
+// transparent huge pages
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+/*
+ * @brief Ask the kernel to back a span with transparent huge pages.
+ *
+ * Only the huge-page-aligned interior of the span is advised; spans
+ * smaller than one huge page are left alone. The advice is best effort:
+ * kernels without THP (or with it disabled) refuse it and the span stays
+ * on normal pages, which is the correct fallback.
+ *
+ * @param rawMem the start of the span
+ * @param size the length of the span in bytes
+ */
+static void _adviseHugePages(void *rawMem, size_t size)
+{
+#ifdef MADV_HUGEPAGE
+	char *start = (char *)(((uintptr_t)rawMem + HUGE_PAGE_SIZE - 1) & ~((uintptr_t)HUGE_PAGE_SIZE - 1));
+	char *end = (char *)(((uintptr_t)rawMem + size) & ~((uintptr_t)HUGE_PAGE_SIZE - 1));
+
+	if (end > start)
+		madvise(start, end - start, MADV_HUGEPAGE);
+#endif
+}
+#endif
+
+#ifdef MALLOC_NUMA
+// Width of the nodemask handed to mbind; generous for any current machine.
+#define NUMA_MAX_NODES 1024
+
+/*
+ * @brief Report the NUMA node the calling thread is running on.
+ *
+ * @return The current node, or -1 if the kernel cannot say
+ */
+static int _currentNode()
+{
+	unsigned int cpu, node;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+		return -1;
+	return (int)node;
+}
+
+/*
+ * @brief Bind a span's pages to one NUMA node with mbind.
+ *
+ * Only the page-aligned interior of the span is bound; mbind is issued
+ * as a raw syscall so builds need no libnuma. The binding is best
+ * effort: on kernels without NUMA support (or for an invalid node) the
+ * span simply keeps the default first-touch placement.
+ *
+ * @param rawMem the start of the span
+ * @param size the length of the span in bytes
+ * @param node the node to place the pages on
+ * @param mode MPOL_PREFERRED or MPOL_BIND
+ */
+static void _bindToNode(void *rawMem, size_t size, int node, int mode)
+{
+	if (node < 0)
+		return;
+
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	char *start = (char *)(((uintptr_t)rawMem + pageSize - 1) & ~(pageSize - 1));
+	char *end = (char *)(((uintptr_t)rawMem + size) & ~(pageSize - 1));
+	if (end <= start)
+		return;
+
+	unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+	mask[node / (8 * sizeof(unsigned long))] =
+			1ul << (node % (8 * sizeof(unsigned long)));
+
+	// MPOL_MF_MOVE migrates pages already faulted in; chunks are bound
+	// before first touch, but myMallocOnNode binds after the block
+	// header has been written.
+	syscall(SYS_mbind, start, end - start, mode, mask,
+			(unsigned long)NUMA_MAX_NODES, MPOL_MF_MOVE);
+}
+#endif
+
 /*
  * @brief Allocate another chunk from the OS and prepare to insert it
  * into the freelist.
  *
  * @param size The size to allocate from the OS
  *
- * @return A pointer to the allocable block in the chunk (just after the 
+ * @return A pointer to the allocable block in the chunk (just after the
  * first fencepost)
  */
-static Header *allocChunk(size_t size) 
+static Header *allocChunk(size_t size)
 {
+	// Serialize sbrk so concurrent arenas get disjoint chunks; the chunk
+	// counter shares its critical section.
+	pthread_mutex_lock(&chunkMutex);
 	void *mem = sbrk(size);
-  
+	if (mem == (void *)-1) {
+		// The OS refused more memory. Fail before touching the chunk so
+		// exhaustion is a clean NULL, not fenceposts written through -1.
+		pthread_mutex_unlock(&chunkMutex);
+		return NULL;
+	}
+	statChunks++;
+	statHeapBytes += size;
+#ifdef MALLOC_VALIDATE
+	heapEnd = (char *)mem + size;
+#endif
+	pthread_mutex_unlock(&chunkMutex);
+
+#ifdef MALLOC_HUGEPAGES
+	if (size >= HUGE_PAGE_SIZE)
+		_adviseHugePages(mem, size);
+#endif
+
+#ifdef MALLOC_NUMA
+	// Place the chunk on the caller's node before anything touches it:
+	// with per-thread arenas the boundary tags and the blocks carved from
+	// them stay local to the threads that walk them.
+	_bindToNode(mem, size, _currentNode(), MPOL_PREFERRED);
+#endif
+
   	insertFenceposts(mem, size);
   	Header *hdr = (Header *)((char *)mem + ALLOC_HEADER_SIZE);
   	setState(hdr, UNALLOCATED);
   	setSize(hdr, size - 2 * ALLOC_HEADER_SIZE);
+#ifndef MALLOC_FOOTERS
   	hdr -> leftSize = ALLOC_HEADER_SIZE;
+#endif
   	return hdr;
 }
 
-// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 /*
- * @brief Compute the actual size of memory allocation from the raw size.
+ * @brief Donate the emergency reserve to an arena's freelists during OOM.
+ *
+ * Called with the arena mutex held. The reserve sits below the first
+ * chunk, so it is never contiguous with the arena's last fencepost and
+ * enters the chunk index as a standalone chunk.
+ *
+ * @param arena the arena that failed to grow the heap
+ *
+ * @return True if the reserve was still available and donated
+ */
+static bool _releaseReserve(Arena *arena)
+{
+	pthread_mutex_lock(&chunkMutex);
+	void *mem = emergencyReserve;
+	emergencyReserve = NULL;
+	if (mem != NULL) {
+		// The reserve enters service as an ordinary chunk.
+		statChunks++;
+		statHeapBytes += ARENA_SIZE;
+	}
+	pthread_mutex_unlock(&chunkMutex);
+
+	if (mem == NULL)
+		return false;
+
+	insertFenceposts(mem, ARENA_SIZE);
+	Header *hdr = (Header *)((char *)mem + ALLOC_HEADER_SIZE);
+	setState(hdr, UNALLOCATED);
+	setSize(hdr, ARENA_SIZE - 2 * ALLOC_HEADER_SIZE);
+#ifndef MALLOC_FOOTERS
+	hdr -> leftSize = ALLOC_HEADER_SIZE;
+#endif
+
+	insertChunk(arena, (Header *)mem);
+	_insertBlock(arena, hdr);
+	return true;
+}
+
+/*
+ * @brief Get the arena owned by the calling thread.
  *
- * @param rawSize Request size of a user
+ * With a single arena every thread shares arenas[0]. Otherwise threads are
+ * assigned an arena round-robin the first time they allocate.
  *
- * @return An actual size to be allocated
+ * @return The arena the calling thread allocates from
  */
-static size_t _calcActualSize(size_t rawSize)
+static inline Arena *getArena()
 {
-	// Round up the raw size to be a multiple of 8-byte.
-	rawSize = rawSize % MULTIPLE_8 == 0 ? rawSize : (((rawSize / MULTIPLE_8) + 1) * MULTIPLE_8);
-	// Actual size = rounded request size + allocated metadata
-	size_t actualSize = ALLOC_HEADER_SIZE + rawSize; 
-	// Minimum allocation size = unallocated header size
-	actualSize = actualSize > UNALLOC_HEADER_SIZE ? actualSize : UNALLOC_HEADER_SIZE;
+#if defined(MALLOC_SHARDS)
+	// Sharded builds route by size class, not by thread; callers with no
+	// size at hand (region donations, NULL frees) use the first shard,
+	// whose scans start at the smallest classes and reach every list.
+	return &arenas[0];
+#elif MALLOC_ARENAS > 1
+	if (threadArena == NULL)
+		threadArena = &arenas[__atomic_fetch_add(&nextArena, 1, __ATOMIC_RELAXED) % MALLOC_ARENAS];
+	return threadArena;
+#else
+	return &arenas[0];
+#endif
+}
 
-	return actualSize;
+#ifdef MALLOC_SHARDS
+/*
+ * @brief Get the arena of the shard that serves a size class.
+ *
+ * @param actualSize an actual size of memory allocation
+ *
+ * @return The arena whose freelist group covers the size's class
+ */
+static inline Arena *getShardArena(size_t actualSize)
+{
+	return &arenas[_getFreelistIndex(actualSize) * MALLOC_SHARDS / NUM_LISTS];
 }
+#endif
 
+#if MALLOC_ARENAS > 1
 /*
- * @brief Compute an index of a freelist to get a block for allocation based on the actual size.
- * 
- * @param actualSize The actual size of memory allocation.
+ * @brief Find the arena whose chunks contain a block.
+ *
+ * Chunks obtained by coalescing with a previous contiguous chunk are not
+ * entered into chunkList, so the owner is the chunk with the greatest start
+ * address at or below the block.
+ *
+ * @param hdr A header of a block inside some chunk
  *
- * @return An index of an appropriate freelist
+ * @return The arena that allocated the chunk containing hdr
  */
-static int _getFreelistIndex(size_t actualSize)
+static Arena *findBlockArena(Header *hdr)
 {
-	// A block in a freelist excludes metadata.
-	int index = ((actualSize - ALLOC_HEADER_SIZE) / MULTIPLE_8) - 1;
-	// Index must be smaller than the NUM_LISTS.
-	return index < NUM_LISTS ? index : NUM_LISTS - 1;
+	Arena *owner = &arenas[0];
+
+	pthread_mutex_lock(&chunkMutex);
+	ssize_t i = findChunkIndex(hdr);
+	if (i >= 0)
+		owner = chunkArenas[i];
+	pthread_mutex_unlock(&chunkMutex);
+
+	return owner;
 }
+#endif
 
+// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 /*
  * @brief Determine if a freelist is empty.
  *
@@ -244,7 +1056,7 @@ static int _getFreelistIndex(size_t actualSize)
 static bool _isEmptyFreelist(Header *hdr)
 {
 	// Sentinel is a dummy node.
-	return hdr -> next == hdr;
+	return getNext(hdr) == hdr;
 }
 
 /*
@@ -259,75 +1071,390 @@ static bool _isSameIndex(int one, int other)
 	return one == other;
 }
 
+#ifdef MALLOC_INCREMENTAL
+/*
+ * Incremental verification. Building with -DMALLOC_INCREMENTAL makes the
+ * structural hot paths record each header they produce in a small dirty
+ * set, together with a snapshot of its size words. verifyIncremental
+ * then checks only those headers in O(changes): an entry whose bytes no
+ * longer match its snapshot has been mutated or absorbed since (and the
+ * mutation recorded its own entry), so it is skipped. When the set
+ * overflows, the next check falls back to the full verify scan.
+ */
+#define DIRTY_SET_SIZE 512
+
+typedef struct {
+	Header *hdr;
+	// Raw size word (including state bits) and leftSize at mark time
+	size_t size;
+	size_t leftSize;
+} DirtyEntry;
+
+static DirtyEntry dirtySet[DIRTY_SET_SIZE];
+static size_t numDirty;
+static bool dirtyOverflow;
+static pthread_mutex_t dirtyMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * @brief Record a header touched by the allocator for the next check.
+ *
+ * @param hdr the header whose invariants changed
+ */
+static void _markDirty(Header *hdr)
+{
+	pthread_mutex_lock(&dirtyMutex);
+	if (numDirty == DIRTY_SET_SIZE) {
+		dirtyOverflow = true;
+	} else {
+		dirtySet[numDirty].hdr = hdr;
+		dirtySet[numDirty].size = hdr -> size;
+		dirtySet[numDirty].leftSize = hdr -> leftSize;
+		numDirty++;
+	}
+	pthread_mutex_unlock(&dirtyMutex);
+}
+
+/*
+ * @brief Drop the entries of a header absorbed by coalescing.
+ *
+ * An absorbed header becomes interior bytes of the merged block without
+ * being rewritten, so its snapshot would still match; remove its entries
+ * so stale checks cannot run against user data.
+ *
+ * @param hdr the header absorbed into its left neighbor
+ */
+static void _unmarkDirty(Header *hdr)
+{
+	pthread_mutex_lock(&dirtyMutex);
+	size_t i = 0;
+	while (i < numDirty) {
+		if (dirtySet[i].hdr == hdr)
+			dirtySet[i] = dirtySet[--numDirty];
+		else
+			i++;
+	}
+	pthread_mutex_unlock(&dirtyMutex);
+}
+#endif
+
 /*
  * @brief Insert a block at the beginning of a freelist.
  *
  * @param hdr a header
  */
-static void _insertBlock(Header *hdr)
+static void _insertBlock(Arena *arena, Header *hdr)
 {
 	int index = _getFreelistIndex(getSize(hdr));
-	Header *sentinel = &freelists[index];
+	Header *sentinel = &arena -> freelists[index].sentinel;
 
 	if (!_isEmptyFreelist(sentinel)) {
-		sentinel -> next -> prev = hdr;
-		hdr -> next = sentinel -> next;
+		setPrev(getNext(sentinel), hdr);
+		setNext(hdr, getNext(sentinel));
 	} else {
-		sentinel -> prev = hdr;
-		hdr -> next = sentinel;
+		setPrev(sentinel, hdr);
+		setNext(hdr, sentinel);
 	}
 
-	sentinel -> next = hdr;
-	hdr -> prev = sentinel;
+	setNext(sentinel, hdr);
+	setPrev(hdr, sentinel);
+
+	arena -> freeBytesByClass[index] += getSize(hdr);
+#ifdef MALLOC_FOOTERS
+	_publishBlock(hdr);
+#endif
+	_setBitmap(arena, index);
+
+#ifdef MALLOC_BESTFIT
+	if (index == NUM_LISTS - 1)
+		_trieInsert(arena, hdr);
+#endif
+
+#ifdef MALLOC_INCREMENTAL
+	_markDirty(hdr);
+#endif
 }
 
 /*
  * @brief Remove a block from a freelist.
  *
- * @param hdr a header
+ * The index is passed by the caller because a block being re-homed may
+ * already carry a new size that maps to a different list.
+ *
+ * @param arena the arena whose freelists hold the block, hdr a header,
+ *        index the index of the freelist the block is currently on
+ */
+static void _removeBlock(Arena *arena, Header *hdr, int index)
+{
+	arena -> freeBytesByClass[index] -= getSize(hdr);
+	setNext(getPrev(hdr), getNext(hdr));
+	setPrev(getNext(hdr), getPrev(hdr));
+
+	// If the block was the last one in its freelist, the neighbors are both
+	// the sentinel and the list's bitmap bit must be cleared.
+	if (getPrev(hdr) == getNext(hdr) && getPrev(hdr) == &arena -> freelists[index].sentinel)
+		_clearBitmap(arena, index);
+
+#ifdef MALLOC_BESTFIT
+	if (index == NUM_LISTS - 1)
+		_trieRemove(arena, hdr);
+#endif
+}
+
+/*
+ * @brief Mark a freelist non-empty in the arena's bitmap.
+ *
+ * @param arena an arena, index the index of the freelist
+ */
+static void _setBitmap(Arena *arena, int index)
+{
+	arena -> freelistBitmap[index >> 3] |= 1 << (index & 7);
+}
+
+/*
+ * @brief Mark a freelist empty in the arena's bitmap.
+ *
+ * @param arena an arena, index the index of the freelist
+ */
+static void _clearBitmap(Arena *arena, int index)
+{
+	arena -> freelistBitmap[index >> 3] &= ~(1 << (index & 7));
+}
+
+/*
+ * @brief Find the first non-empty freelist at or above an index.
+ *
+ * Scans the arena's bitmap with __builtin_ctzll instead of probing the
+ * sentinels one at a time. The final (overflow) freelist is returned when
+ * no smaller class can satisfy the request, as it is always searched.
+ *
+ * @param arena an arena, index the lowest acceptable freelist index
+ *
+ * @return The index of the first non-empty freelist, or NUM_LISTS - 1
  */
-static void _removeBlock(Header *hdr)
+static int _nextNonEmptyList(Arena *arena, int index)
 {
-	hdr -> prev -> next = hdr -> next;
-	hdr -> next -> prev = hdr -> prev;
+	for (int byte = index >> 3; byte < (NUM_LISTS + 7) / 8; byte++) {
+		unsigned long long word = (unsigned char)arena -> freelistBitmap[byte];
+		// Ignore lists below the requested index in the first byte.
+		if (byte == (index >> 3))
+			word &= ~0ULL << (index & 7);
+		if (word != 0) {
+			int i = (byte << 3) + __builtin_ctzll(word);
+			if (i < NUM_LISTS - 1)
+				return i;
+			break;
+		}
+	}
+
+	return NUM_LISTS - 1;
 }
 
 /*
  * @brief Update a block from a freelist.
  *
- * @param hdr a header
+ * @param arena an arena, hdr a header,
+ *        oldIndex the index of the freelist the block is currently on
+ */
+static void _updateBlock(Arena *arena, Header *hdr, int oldIndex)
+{
+	_removeBlock(arena, hdr, oldIndex);
+	_insertBlock(arena, hdr);
+}
+
+/*
+ * @brief Determine if a resized block must be moved to another freelist.
+ *
+ * @param oldIndex the freelist the block is on, newIndex the freelist its
+ *        new size maps to
+ *
+ * @return True if the block must be removed and re-inserted
+ */
+static bool _needsRehome(int oldIndex, int newIndex)
+{
+#ifdef MALLOC_BESTFIT
+	// The overflow trie is keyed on the exact size, so a resized overflow
+	// block must be re-inserted even when its list index is unchanged.
+	if (oldIndex == NUM_LISTS - 1 && newIndex == NUM_LISTS - 1)
+		return true;
+#endif
+	return !_isSameIndex(oldIndex, newIndex);
+}
+
+#ifdef MALLOC_BESTFIT
+/*
+ * @brief Insert an overflow block into the size-keyed trie.
+ *
+ * Blocks whose size is already present join that block's same-size ring
+ * instead of adding a tree node.
+ *
+ * @param arena an arena, hdr a header of a free overflow block
+ */
+static void _trieInsert(Arena *arena, Header *hdr)
+{
+	TrieNode *node = trieNode(hdr);
+
+	// The trie node dirties the data area past the freelist pointers, so
+	// the block is no longer OS-fresh and myCalloc must zero it in full.
+	setRecycled(hdr, true);
+	size_t key = getSize(hdr);
+	Header **link = &arena -> trieRoot;
+	int bit = TRIE_START_BIT;
+
+	while (*link != NULL) {
+		Header *curr = *link;
+
+		if (getSize(curr) == key) {
+			// Same size: join the ring hanging off the tree node.
+			TrieNode *currNode = trieNode(curr);
+			node -> parentLink = NULL;
+			node -> sameNext = currNode -> sameNext;
+			node -> samePrev = curr;
+			trieNode(currNode -> sameNext) -> samePrev = hdr;
+			currNode -> sameNext = hdr;
+			return;
+		}
+
+		link = &trieNode(curr) -> child[(key >> bit) & 1];
+		bit--;
+	}
+
+	node -> child[0] = NULL;
+	node -> child[1] = NULL;
+	node -> parentLink = link;
+	node -> sameNext = hdr;
+	node -> samePrev = hdr;
+	*link = hdr;
+}
+
+/*
+ * @brief Remove an overflow block from the size-keyed trie.
+ *
+ * @param arena an arena, hdr a header of a block in the trie
+ */
+static void _trieRemove(Arena *arena, Header *hdr)
+{
+	(void)arena;
+	TrieNode *node = trieNode(hdr);
+
+	// Blocks sharing their size with others only leave the ring; the tree
+	// node is handed to the next ring member if this block carried it.
+	if (node -> sameNext != hdr) {
+		Header *next = node -> sameNext;
+		Header *prev = node -> samePrev;
+		trieNode(next) -> samePrev = prev;
+		trieNode(prev) -> sameNext = next;
+
+		if (node -> parentLink != NULL) {
+			TrieNode *heir = trieNode(next);
+			heir -> child[0] = node -> child[0];
+			heir -> child[1] = node -> child[1];
+			heir -> parentLink = node -> parentLink;
+			*heir -> parentLink = next;
+			if (heir -> child[0] != NULL)
+				trieNode(heir -> child[0]) -> parentLink = &heir -> child[0];
+			if (heir -> child[1] != NULL)
+				trieNode(heir -> child[1]) -> parentLink = &heir -> child[1];
+		}
+		return;
+	}
+
+	// Detach the deepest descendant and put it in the removed node's place.
+	Header *leaf = node -> child[1] != NULL ? node -> child[1] : node -> child[0];
+	if (leaf == NULL) {
+		*node -> parentLink = NULL;
+		return;
+	}
+
+	TrieNode *leafNode = trieNode(leaf);
+	while (leafNode -> child[1] != NULL || leafNode -> child[0] != NULL) {
+		leaf = leafNode -> child[1] != NULL ? leafNode -> child[1] : leafNode -> child[0];
+		leafNode = trieNode(leaf);
+	}
+
+	*leafNode -> parentLink = NULL;
+	leafNode -> child[0] = node -> child[0];
+	leafNode -> child[1] = node -> child[1];
+	leafNode -> parentLink = node -> parentLink;
+	*leafNode -> parentLink = leaf;
+	if (leafNode -> child[0] != NULL)
+		trieNode(leafNode -> child[0]) -> parentLink = &leafNode -> child[0];
+	if (leafNode -> child[1] != NULL)
+		trieNode(leafNode -> child[1]) -> parentLink = &leafNode -> child[1];
+}
+
+/*
+ * @brief Find the smallest overflow block large enough for a request.
+ *
+ * Descends the trie along the key's bits, remembering the last right
+ * subtree passed over: every block in it is larger than the request, so
+ * its minimum is the best fit when nothing on the path matched.
+ *
+ * @param arena an arena, actualSize An actual size of memory allocation
+ *
+ * @return The best fitting block or NULL if none is large enough
  */
-static void _updateBlock(Header *hdr)
+static Header *_trieBestFit(Arena *arena, size_t actualSize)
 {
-	_removeBlock(hdr);
-	_insertBlock(hdr);
+	Header *best = NULL;
+	Header *subtree = NULL;
+	int bit = TRIE_START_BIT;
+
+	for (Header *curr = arena -> trieRoot; curr != NULL; bit--) {
+		size_t currSize = getSize(curr);
+
+		if (currSize == actualSize)
+			return curr;
+		if (currSize > actualSize && (best == NULL || currSize < getSize(best)))
+			best = curr;
+
+		int dir = (actualSize >> bit) & 1;
+		if (dir == 0 && trieNode(curr) -> child[1] != NULL)
+			subtree = trieNode(curr) -> child[1];
+		curr = trieNode(curr) -> child[dir];
+	}
+
+	for (Header *curr = subtree; curr != NULL;) {
+		if (best == NULL || getSize(curr) < getSize(best))
+			best = curr;
+		TrieNode *node = trieNode(curr);
+		curr = node -> child[0] != NULL ? node -> child[0] : node -> child[1];
+	}
+
+	return best;
 }
+#endif
 
 /*
  * @brief Coalesce two distinct chunks.
  *
  * @param prevBlock A header to the left of the currBlock, currBlock A header of the current block
  */
-static void *_coalesceChunks(Header *prevBlock, Header *currBlock)
+static void *_coalesceChunks(Arena *arena, Header *prevBlock, Header *currBlock)
 {
-	// Get the 2nd fencepost of the previous chunk.
-	Header *prevSecondFencepost = getRightHeader(prevBlock); 
+	// Get the 2nd fencepost of the previous chunk: the chunks are
+	// contiguous, so it sits just below the current chunk's first fencepost.
+	Header *prevSecondFencepost = getHeaderFromOffset(currBlock, -2 * ALLOC_HEADER_SIZE);
 	// Get the 2nd fencepost of the current chunk.
 	Header *currSecondFencepost = getRightHeader(currBlock);
 
 	size_t index;
 	size_t coalescedSize;
-	// If the previous  block is unallocated.
-	if (getState(prevBlock) == UNALLOCATED) {	
+	// If the previous  block is unallocated. (With MALLOC_FOOTERS an
+	// allocated previous block is unreachable and passed as NULL.)
+	if (prevBlock != NULL && getState(prevBlock) == UNALLOCATED) {
 		index = _getFreelistIndex(getSize(prevBlock));
 		// Coalesce two chunks.(previous block + current block + 2 * fencepost)
 		// Update the size, left size.
 		coalescedSize = getSize(prevBlock) + getSize(currBlock) + 2 * ALLOC_HEADER_SIZE;
+		// The previous block grows in place on its list.
+		arena -> freeBytesByClass[index] += coalescedSize - getSize(prevBlock);
 		setSize(prevBlock, coalescedSize);
+		// The dissolved fenceposts leave non-zero bytes inside the block.
+		setRecycled(prevBlock, true);
 
 		// If the coalesced chunk does not fit, insert into an appropriate freelist.
-		if (index != _getFreelistIndex(getSize(prevBlock)))
-			_updateBlock(prevBlock);
+		if (_needsRehome(index, _getFreelistIndex(getSize(prevBlock))))
+			_updateBlock(arena, prevBlock, index);
 	// If the previous block is allocated.
 	} else { 	
 		// Coalesce the two chunks.(current block + 2 * fencepost)
@@ -335,101 +1462,291 @@ static void *_coalesceChunks(Header *prevBlock, Header *currBlock)
 		coalescedSize = getSize(currBlock) + 2 * ALLOC_HEADER_SIZE;
 		setSize(prevSecondFencepost, coalescedSize);
 		setState(prevSecondFencepost, UNALLOCATED);
+		// The dissolved fenceposts leave non-zero bytes inside the block.
+		setRecycled(prevSecondFencepost, true);
 		// Fencepost is now a header, so there is no need to remove the block.
-		_insertBlock(prevSecondFencepost);
+		_insertBlock(arena, prevSecondFencepost);
 	}
 
-	// Update the last fencepost (global variable).
+	// Update the boundary tag under the current chunk's second fencepost.
+#ifdef MALLOC_FOOTERS
+	// The freelist insert published the fencepost-conversion case; a grown
+	// previous block that stayed on its list re-publishes here.
+	(void)currSecondFencepost;
+	if (prevBlock != NULL && getState(prevBlock) == UNALLOCATED)
+		_publishBlock(prevBlock);
+#else
 	currSecondFencepost -> leftSize = coalescedSize;
+#endif
+}
+
+/*
+ * @brief Allocate from a chosen free block, splitting it when possible.
+ *
+ * @param arena an arena, curr a free block large enough for the request,
+ *        index the index of the freelist the block is on,
+ *        actualSize An actual size of memory allocation
+ *
+ * @return A header to the data region of the allocated block
+ */
+static Header *_takeBlock(Arena *arena, Header *curr, int index, size_t actualSize)
+{
+	size_t currSize = getSize(curr);
+
+	// If current block size equals actual size or the difference is smaller than the minimum block size.
+	// Why the minimum block? The remainder must be able to stand as its own free block.
+	// Remove it from the freelist.
+	arena -> stats.mallocs++;
+
+	if ((currSize == actualSize) || ((currSize - actualSize) < MIN_BLOCK_SIZE)) {
+		setState(curr, ALLOCATED);
+		_removeBlock(arena, curr, index);
+
+#ifdef MALLOC_FOOTERS
+		_publishBlock(curr);
+#endif
+#ifdef MALLOC_INCREMENTAL
+		_markDirty(curr);
+#endif
+		return (Header *)(curr -> data);
+	}
+
+	arena -> stats.splits++;
+
+	// If the difference exceeds the unallocated header size, split the current block into two smaller blocks.
+	// Allocate the rightmost block.
+#ifdef MALLOC_BESTFIT
+	/*
+	 * Fully detach an overflow block before splitting: the new right-block
+	 * header is written into the data area, where it may overlap the trie
+	 * node, so the node must be unlinked while it is still intact. The
+	 * shrunken remainder is re-inserted below.
+	 */
+	bool predetached = index == NUM_LISTS - 1;
+	if (predetached)
+		_removeBlock(arena, curr, index);
+#endif
+	// Split the current block into two smaller blocks. The remainder stays
+	// on its freelist (unless predetached), so its class loses the bytes
+	// the allocation takes.
+#ifdef MALLOC_BESTFIT
+	if (!predetached)
+		arena -> freeBytesByClass[index] -= actualSize;
+#else
+	arena -> freeBytesByClass[index] -= actualSize;
+#endif
+	setSize(curr, currSize - actualSize);
+	currSize = getSize(curr);
+
+	// Update the right block.
+	Header *rightBlock = getRightHeader(curr);
+	setSize(rightBlock, actualSize);
+	setState(rightBlock, ALLOCATED);
+	setRecycled(rightBlock, getRecycled(curr));
+#ifdef MALLOC_FOOTERS
+	// The shrunken remainder re-publishes its footer under the right
+	// block; the allocated right block lowers its own neighbor's flag.
+	_publishBlock(curr);
+	_publishBlock(rightBlock);
+#else
+	rightBlock -> leftSize = currSize;
+
+	// Update the right block's next block.
+	Header *nextBlock = getRightHeader(rightBlock);
+	nextBlock -> leftSize = actualSize;
+#endif
+
+	// If the remaining block does not fit in the current freelist.
+	// Remove and put it into the appropriate freelist.
+#ifdef MALLOC_INCREMENTAL
+	_markDirty(rightBlock);
+#endif
+#ifdef MALLOC_BESTFIT
+	if (predetached) {
+		_insertBlock(arena, curr);
+		return (Header *)(rightBlock -> data);
+	}
+#endif
+	if (_needsRehome(index, _getFreelistIndex(currSize)))
+		_updateBlock(arena, curr, index);
+
+	return (Header *)(rightBlock -> data);
 }
 
 /*
  * @brief Allocate a block based on a freelist index and an actual size.
  *
+ * The search is a flat iteration: scan the freelists for a fit; on a
+ * miss, coalesce deferred frees (deferred builds) or grow the heap, then
+ * rescan. The chunk-allocation fallback sits outside the scan loop so
+ * the no-fit path is a single predictable branch, and the number of
+ * rescans is explicitly bounded, so the worst-case latency of one call
+ * is a fixed number of passes rather than an unbounded recursion.
+ *
  * @param index An index of a freelist where a block resides, actualSize An actual size of memory allocation
  *
  * @return A header to a block
  */
-static Header *_allocBlock(int index, size_t actualSize)
+static Header *_allocBlock(Arena *arena, int index, size_t actualSize)
 {
-	for (int i = index; i < NUM_LISTS; i++) {
-		// Get a freelist at index i.
-		Header *sentinel = &freelists[i];
-		
-		// Search only an non-empty freelist.
-		// Exception: final freelist (i.e. i == NUM_LISTS - 1), iterate over the freelist.
-		if (sentinel == sentinel -> next && i != NUM_LISTS - 1)
-			continue;	
-
-		for (Header *curr = sentinel -> next; curr != sentinel; curr = curr -> next) {
-			size_t currSize = getSize(curr);
-			size_t newIndex;
-			// If current block size equals actual size or the difference is smaller than unallocated header size. 
-			// Why unallocated header? Minimum allocation size equals unallocated header size.
-			// Remove it from the freelist.
-			if ((currSize == actualSize) || ((currSize - actualSize) < UNALLOC_HEADER_SIZE)) {
-				setState(curr, ALLOCATED);
-				_removeBlock(curr);
-
-				return (Header *)(curr -> data);
-			// If the difference exceeds the unallocated header size, split the current block into two smaller blocks.
-			// Allocate the rightmost block.
-			} else {
-				// Split the current block into two smaller blocks.
-				setSize(curr, currSize - actualSize);
-				currSize = getSize(curr);
-				
-				// Update the right block.
-				Header *rightBlock = getRightHeader(curr); 
-				setSize(rightBlock, actualSize);
-				setState(rightBlock, ALLOCATED);
-				rightBlock -> leftSize = currSize;
-			
-				// Update the right block's next block.
-				Header *nextBlock = getRightHeader(rightBlock); 
-				nextBlock -> leftSize = actualSize;
-
-				// If the remaining block does not fit in the current freelist.
-				// Remove and put it into the appropriate freelist.
-				newIndex = _getFreelistIndex(currSize);
-				if (!_isSameIndex(newIndex, i))
-					_updateBlock(curr);
-
-				return (Header *)(rightBlock -> data);
+	// A fresh chunk's payload always fits any request that passed the
+	// mmap threshold check, so two chunk requests (the second after a
+	// chunk that coalesced into earlier memory) bound the retries.
+	int chunksAllocated = 0;
+
+	while (true) {
+		// Jump straight to the first non-empty freelist using the bitmap
+		// instead of probing the empty sentinels one at a time. The final
+		// (overflow) freelist ends the scan: it holds every remaining
+		// size, so once its search fails nothing on the freelists fits.
+		for (int i = _nextNonEmptyList(arena, index); ; i = _nextNonEmptyList(arena, i + 1)) {
+			// Get a freelist at index i.
+			Header *sentinel = &arena -> freelists[i].sentinel;
+
+			if (i == NUM_LISTS - 1) {
+#ifdef MALLOC_BESTFIT
+				// Take the smallest fitting block from the overflow trie
+				// instead of settling for the head of the list.
+				Header *curr = _trieBestFit(arena, actualSize);
+				if (curr != NULL)
+					return _takeBlock(arena, curr, i, actualSize);
+#else
+				// The final freelist holds every size past the exact
+				// classes, so its head is not guaranteed to fit; walk it
+				// for the first block that is large enough.
+				for (Header *curr = getNext(sentinel); curr != sentinel; curr = getNext(curr)) {
+					// Overlap the next node's miss with this size check.
+					__builtin_prefetch(getNext(curr));
+					arena -> stats.searchSteps++;
+					if (getSize(curr) >= actualSize)
+						return _takeBlock(arena, curr, i, actualSize);
+				}
+#endif
+				break;
+			}
+
+#ifdef MALLOC_SIZECLASSES
+			/*
+			 * A geometric class holds a range of sizes, so the request's
+			 * own class is not guaranteed to fit and must be walked; every
+			 * later class starts above this one's boundary and its head
+			 * always fits.
+			 */
+			if (i >= NUM_LINEAR_LISTS && i == index) {
+				for (Header *curr = getNext(sentinel); curr != sentinel; curr = getNext(curr)) {
+					// Overlap the next node's miss with this size check.
+					__builtin_prefetch(getNext(curr));
+					arena -> stats.searchSteps++;
+					if (getSize(curr) >= actualSize)
+						return _takeBlock(arena, curr, i, actualSize);
+				}
+				continue;
 			}
-		}	
+#endif
+
+			if (!_isEmptyFreelist(sentinel))
+				return _takeBlock(arena, getNext(sentinel), i, actualSize);
+		}
+
+#ifdef MALLOC_DEFERRED
+		// Allocation miss: coalesce the deferred frees in one batch and
+		// rescan the freelists before growing the heap.
+		if (arena -> quickList != NULL) {
+			_consolidateArena(arena);
+			continue;
+		}
+#endif
 
 		// No available block large enough to fit the actual size.
 		// Allocate a new chunk of memory from the OS.
-		Header *currBlock = allocChunk(ARENA_SIZE);
+		if (chunksAllocated++ == 2) {
+			errno = ENOMEM;
+			return NULL;
+		}
+
+		Header *currBlock = allocChunk(arena -> nextChunkSize);
+		if (currBlock == NULL) {
+			// The OS refused more memory: donate the emergency reserve
+			// and rescan so the caller can still log and shed load. Once
+			// the reserve is gone, fail fast with ENOMEM.
+			if (_releaseReserve(arena))
+				continue;
+			errno = ENOMEM;
+			return NULL;
+		}
+#if CHUNK_GROWTH_FACTOR > 1
+		// Grow the next OS request geometrically up to the cap.
+		if (arena -> nextChunkSize < CHUNK_GROWTH_CAP / CHUNK_GROWTH_FACTOR)
+			arena -> nextChunkSize *= CHUNK_GROWTH_FACTOR;
+		else
+			arena -> nextChunkSize = CHUNK_GROWTH_CAP;
+#endif
 		size_t currBlockSize = getSize(currBlock);
-		Header *currFirstFencepost = getLeftHeader(currBlock); 
+		// The first fencepost sits exactly one allocated header below the
+		// chunk's block.
+		Header *currFirstFencepost = getHeaderFromOffset(currBlock, -ALLOC_HEADER_SIZE);
 		Header *currSecondFencepost = getRightHeader(currBlock);
 
 		// Previous block.
 		Header *prevSecondFencepost = getHeaderFromOffset(currFirstFencepost, -ALLOC_HEADER_SIZE);
-		Header *prevBlock = getLeftHeader(prevSecondFencepost);
 	
 		// The previous block and current block are contiguous. Coalesce two chunks.
-		if (prevSecondFencepost == lastFencepost) {
-			_coalesceChunks(prevBlock, currBlock);				
+		// Only read the previous block once the fencepost is known to be this
+		// arena's own; the memory below a foreign chunk may still be under
+		// construction by another thread.
+		if (prevSecondFencepost == arena -> lastFencepost) {
+#ifdef MALLOC_FOOTERS
+			// Only a free block leaves a footer under the fencepost; an
+			// allocated one is unreachable and stays untouched.
+			Header *prevBlock = getLeftFree(prevSecondFencepost) ?
+					getLeftHeader(prevSecondFencepost) : NULL;
+#else
+			Header *prevBlock = getLeftHeader(prevSecondFencepost);
+#endif
+			_coalesceChunks(arena, prevBlock, currBlock);
 		// The previous block and current block are not contiguous. Insert a new chunk.
 		} else {
 			// Insert a chunk into the chunk list.
-  			 insertChunk(currFirstFencepost);
-			_insertBlock(currBlock);
+  			 insertChunk(arena, currFirstFencepost);
+			_insertBlock(arena, currBlock);
 		}
 		
 		// Update the last fencepost.
-		lastFencepost = currSecondFencepost;
-
-		return _allocBlock(index, actualSize);
+		arena -> lastFencepost = currSecondFencepost;
 	}
 }
 // @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 
-static inline Header *allocObject(size_t rawSize) 
+#if MALLOC_ARENAS > 1
+/*
+ * @brief Drain the arena's remote-free stack through the normal free path.
+ *
+ * Called with the arena mutex held. Detaching the whole stack with one
+ * atomic exchange leaves producers free to keep pushing while the drained
+ * blocks are coalesced.
+ *
+ * @param arena the arena whose remote frees to process
+ */
+static void _drainRemoteFrees(Arena *arena)
+{
+	Header *hdr = __atomic_exchange_n(&arena -> remoteFrees, NULL, __ATOMIC_ACQUIRE);
+
+	while (hdr != NULL) {
+		Header *next = *(Header **)hdr -> data;
+		deallocObject(arena, hdr -> data);
+		hdr = next;
+	}
+}
+#endif
+
+static inline Header *allocObject(Arena *arena, size_t rawSize)
 {
+#if MALLOC_ARENAS > 1
+	// Return blocks other threads freed into this arena before allocating,
+	// so they are available for reuse and coalescing.
+	_drainRemoteFrees(arena);
+#endif
+
 	if (rawSize == 0)
 		return NULL;
 
@@ -437,8 +1754,103 @@ static inline Header *allocObject(size_t rawSize)
 	size_t actualSize = _calcActualSize(rawSize);
 	// Get an Index of a freelist.
 	int index = _getFreelistIndex(actualSize);
+
+	/*
+	 * Exact-fit fast path. Every freelist below the overflow list holds
+	 * blocks of exactly one size, so when the request's own list is
+	 * non-empty its head fits with nothing left over: pop it directly
+	 * and skip the scan loop and the split examination in _takeBlock.
+	 * Geometric classes hold ranges, so only the linear ones qualify.
+	 */
+#ifdef MALLOC_SIZECLASSES
+	if (index < NUM_LINEAR_LISTS) {
+#else
+	if (index < NUM_LISTS - 1) {
+#endif
+		Header *sentinel = &arena -> freelists[index].sentinel;
+		Header *head = getNext(sentinel);
+
+		if (head != sentinel) {
+			arena -> stats.mallocs++;
+			setState(head, ALLOCATED);
+			_removeBlock(arena, head, index);
+#ifdef MALLOC_FOOTERS
+			_publishBlock(head);
+#endif
+#ifdef MALLOC_INCREMENTAL
+			_markDirty(head);
+#endif
+#ifdef MALLOC_HARDEN
+			_stampCanary(head);
+#endif
+			return (Header *)(head -> data);
+		}
+	}
+
 	// Allocate a block from a freelist.
-	return _allocBlock(index, actualSize);
+#ifdef MALLOC_HARDEN
+	Header *mem = _allocBlock(arena, index, actualSize);
+	if (mem != NULL)
+		_stampCanary(ptrToHeader(mem));
+	return mem;
+#else
+	return _allocBlock(arena, index, actualSize);
+#endif
+}
+
+/*
+ * @brief Allocate a large block directly from the OS with mmap.
+ *
+ * The block is tracked outside the freelists: its header stores the
+ * length of the mapping and the MMAPPED state so that deallocObject can
+ * hand the block straight back to the OS with munmap.
+ *
+ * @param actualSize The actual size of memory allocation
+ *
+ * @return A header to the data region of the block, or NULL on failure
+ */
+static Header *mmapObject(size_t actualSize)
+{
+#ifdef MALLOC_FOOTERS
+	// The gap word in front of the header comes out of the mapping, not
+	// the block, so the request must grow by it.
+	actualSize += FOOTER_SIZE;
+#endif
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	// Round the mapping up to a whole number of pages.
+	size_t mapSize = (actualSize + pageSize - 1) & ~(pageSize - 1);
+
+	void *mem = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED)
+		return NULL;
+
+#ifdef MALLOC_HUGEPAGES
+	if (mapSize >= HUGE_PAGE_SIZE)
+		_adviseHugePages(mem, mapSize);
+#endif
+
+	__atomic_fetch_add(&statMmaps, 1, __ATOMIC_RELAXED);
+
+#ifdef MALLOC_FOOTERS
+	// The word in front of the header records the distance back to the
+	// start of the mapping (more than FOOTER_SIZE for aligned blocks).
+	Header *hdr = (Header *)((char *)mem + FOOTER_SIZE);
+	*((size_t *)hdr - 1) = FOOTER_SIZE;
+	setSizeAndState(hdr, mapSize - FOOTER_SIZE, MMAPPED);
+#else
+	Header *hdr = (Header *)mem;
+	setSizeAndState(hdr, mapSize, MMAPPED);
+	hdr -> leftSize = 0;
+#endif
+
+#ifdef MALLOC_HARDEN
+	_stampCanary(hdr);
+#endif
+#ifdef MALLOC_VALIDATE
+	_registerMmap(hdr);
+#endif
+
+	return (Header *)(hdr -> data);
 }
 
 /*
@@ -448,87 +1860,442 @@ static inline Header *allocObject(size_t rawSize)
  *
  * @return A pointer to the Header of the block
  */
-static inline Header *ptrToHeader(void *ptr)  
+static inline Header *ptrToHeader(void *ptr)
 {
 	return (Header *)((char *)ptr - ALLOC_HEADER_SIZE); //sizeof(Header));
 }
 
-static inline void deallocObject(void *ptr)
-{
-	if (ptr == NULL) 
-		return;
-	
-	// Get a current block, previous block, and next block.
-	Header *currBlock = ptrToHeader(ptr);
-	Header *prevBlock = getLeftHeader(currBlock);
-	Header *nextBlock = getRightHeader(currBlock);
+#ifdef MALLOC_VALIDATE
+/*
+ * Building with -DMALLOC_VALIDATE vets every pointer handed to myFree,
+ * myFreeBatch, and myRealloc before a single header byte is read, so a
+ * wild free from buggy caller code is logged and ignored instead of
+ * faulting or silently corrupting the freelists. Chunk-resident
+ * pointers are confirmed against the address-sorted chunk index in
+ * O(log chunks); mmap'd blocks are tracked in the hash set below so
+ * addresses outside the heap are rejected in O(1) without being read.
+ */
 
-	// Get states for the previous block and the next block.	
-	State prevState = getState(prevBlock);
-	State nextState = getState(nextBlock);
+// Open-addressing set of live mmap'd block headers. Slot value 0 is
+// empty and 1 is a tombstone left by an unmapped block.
+#define REGISTRY_TOMBSTONE ((uintptr_t)1)
 
-	// If the block has already been deallocated, freeing it again generates an error.
-	if (getState(currBlock) == UNALLOCATED) {
-		fprintf(stderr, "Double Free Detected\n");
-		fprintf(stderr, "Assertion Failed!\n");
-		exit(1);
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+static uintptr_t *mmapRegistry;
+static size_t registryCapacity;
+// Occupied slots, tombstones included; bounds the probe lengths.
+static size_t registryUsed;
+
+/*
+ * @brief Move the registry to a table of newCapacity slots.
+ *
+ * Called with registryMutex held. Rehashing drops the tombstones, so
+ * this also runs at the current capacity when deletes have piled up.
+ * The table lives in its own mapping: the registry cannot feed back
+ * through the allocator it is guarding.
+ *
+ * @param newCapacity the number of slots in the new table, a power of two
+ */
+static void _registryRehash(size_t newCapacity)
+{
+	uintptr_t *table = mmap(NULL, newCapacity * sizeof(uintptr_t),
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (table == MAP_FAILED)
+		return; // Keep the old table; probes just run longer.
+
+	size_t live = 0;
+	for (size_t i = 0; i < registryCapacity; i++) {
+		uintptr_t key = mmapRegistry[i];
+		if (key <= REGISTRY_TOMBSTONE)
+			continue;
+
+		size_t slot = (key * 0x9e3779b97f4a7c15ull) & (newCapacity - 1);
+		while (table[slot] != 0)
+			slot = (slot + 1) & (newCapacity - 1);
+		table[slot] = key;
+		live++;
 	}
-	
-	// Set the state of the current block unallocated.
-	setState(currBlock, UNALLOCATED);
-	size_t size;
-	int index;
-	int newIndex;
 
-	// Both neighboring blocks are unallocated.
-	if (prevState == UNALLOCATED && nextState == UNALLOCATED) {
-		index = _getFreelistIndex(getSize(prevBlock));
-		size = getSize(prevBlock) + getSize(currBlock) + getSize(nextBlock);
-		setSize(prevBlock, size);
+	if (mmapRegistry != NULL)
+		munmap(mmapRegistry, registryCapacity * sizeof(uintptr_t));
+	mmapRegistry = table;
+	registryCapacity = newCapacity;
+	registryUsed = live;
+}
 
-		Header *nextNextBlock = getRightHeader(nextBlock);
-		nextNextBlock -> leftSize = size;
+/*
+ * @brief Record a freshly mapped block in the registry.
+ *
+ * @param hdr the header of the mmap'd block
+ */
+static void _registerMmap(Header *hdr)
+{
+	uintptr_t key = (uintptr_t)hdr;
+
+	pthread_mutex_lock(&registryMutex);
+	// Keep the load factor below one half so probes stay short.
+	if ((registryUsed + 1) * 2 > registryCapacity)
+		_registryRehash(registryCapacity == 0 ? 64 : registryCapacity * 2);
+
+	if (registryCapacity > 0) {
+		size_t slot = (key * 0x9e3779b97f4a7c15ull) & (registryCapacity - 1);
+		// A reused address can only reappear after its unregister, so
+		// stopping at the first tombstone never creates a duplicate.
+		while (mmapRegistry[slot] > REGISTRY_TOMBSTONE)
+			slot = (slot + 1) & (registryCapacity - 1);
+		if (mmapRegistry[slot] == 0)
+			registryUsed++;
+		mmapRegistry[slot] = key;
+	}
+	pthread_mutex_unlock(&registryMutex);
+}
 
-		// If the coalseced size is not fit for the current freelist where the prevBlock is stored.
-		// Insert it into an appropriate freelist.
-		newIndex = _getFreelistIndex(getSize(prevBlock));
-		if (!_isSameIndex(index, newIndex))
-			_updateBlock(prevBlock);
+/*
+ * @brief Drop a block from the registry as it is returned to the OS.
+ *
+ * @param hdr the header of the mmap'd block being unmapped
+ */
+static void _unregisterMmap(Header *hdr)
+{
+	uintptr_t key = (uintptr_t)hdr;
+
+	pthread_mutex_lock(&registryMutex);
+	if (registryCapacity > 0) {
+		size_t slot = (key * 0x9e3779b97f4a7c15ull) & (registryCapacity - 1);
+		while (mmapRegistry[slot] != 0) {
+			if (mmapRegistry[slot] == key) {
+				mmapRegistry[slot] = REGISTRY_TOMBSTONE;
+				break;
+			}
+			slot = (slot + 1) & (registryCapacity - 1);
+		}
+	}
+	pthread_mutex_unlock(&registryMutex);
+}
 
-	// Only the prev block is unallocated.
-	// Coalesce the current block and the previous block.
-	} else if (prevState == UNALLOCATED) {
-		index = _getFreelistIndex(getSize(prevBlock));
-		size = getSize(prevBlock) + getSize(currBlock);
-		setSize(prevBlock, size);
-		nextBlock -> leftSize = size;
-		
-		// If the coalseced size is not fit for the freelist where the prevBlock is stored.
-		// Insert it into an appropriate freelist.
+/*
+ * @brief Check whether hdr is a live mmap'd block.
+ *
+ * @param hdr the candidate header
+ *
+ * @return True if hdr was registered and not yet unmapped
+ */
+static bool _mmapRegistered(Header *hdr)
+{
+	uintptr_t key = (uintptr_t)hdr;
+	bool found = false;
+
+	pthread_mutex_lock(&registryMutex);
+	if (registryCapacity > 0) {
+		size_t slot = (key * 0x9e3779b97f4a7c15ull) & (registryCapacity - 1);
+		while (mmapRegistry[slot] != 0) {
+			if (mmapRegistry[slot] == key) {
+				found = true;
+				break;
+			}
+			slot = (slot + 1) & (registryCapacity - 1);
+		}
+	}
+	pthread_mutex_unlock(&registryMutex);
+	return found;
+}
+
+/*
+ * @brief Decide whether ptr plausibly backs a live allocation.
+ *
+ * Addresses outside every chunk and not in the mmap registry are
+ * rejected without being read, so the check itself cannot fault. For
+ * chunk-resident pointers the header is then read (everything in the
+ * chunk range is mapped) and its state and size are sanity checked,
+ * which also catches double frees whose block has since been recycled.
+ * Blocks parked in magazines or on deferred quick lists still look
+ * allocated, so their double frees are caught later as before.
+ *
+ * @param ptr the pointer handed to free or realloc
+ *
+ * @return True if ptr may be passed on to the normal paths
+ */
+static bool _validPointer(void *ptr)
+{
+	// Every data area the allocator hands out is at least 8-byte aligned.
+	if (((uintptr_t)ptr & (MIN_ALLOCATION - 1)) != 0)
+		return false;
+
+	Header *hdr = ptrToHeader(ptr);
+
+	pthread_mutex_lock(&chunkMutex);
+	ssize_t i = findChunkIndex(hdr);
+	bool inChunk = i >= 0 &&
+			(char *)hdr >= (char *)chunkList[i] + ALLOC_HEADER_SIZE &&
+			(char *)hdr < (char *)heapEnd;
+	void *end = heapEnd;
+	pthread_mutex_unlock(&chunkMutex);
+
+	if (!inChunk)
+		return _mmapRegistered(hdr);
+
+	if (getState(hdr) != ALLOCATED)
+		return false;
+
+	size_t size = getSize(hdr);
+	return size >= MIN_BLOCK_SIZE && (char *)hdr + size <= (char *)end;
+}
+#endif
+
+#ifdef MALLOC_DECOMMIT
+/*
+ * @brief Return the page-aligned interior of a large free block to the OS.
+ *
+ * The header, freelist pointers, and (with MALLOC_BESTFIT) trie node at
+ * the front of the block stay resident; only whole interior pages are
+ * released with madvise, so the boundary tags and list links survive and
+ * the pages fault back in on the next allocation that touches them.
+ *
+ * @param hdr a free block that may have grown past DECOMMIT_THRESHOLD
+ */
+static void _decommitBlock(Header *hdr)
+{
+	if (getSize(hdr) < DECOMMIT_THRESHOLD)
+		return;
+
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	char *start = (char *)hdr + UNALLOC_HEADER_SIZE;
+#ifdef MALLOC_BESTFIT
+	start += sizeof(TrieNode);
+#endif
+	char *end = (char *)hdr + getSize(hdr);
+#ifdef MALLOC_FOOTERS
+	// The footer in the block's last word must survive the decommit.
+	end -= FOOTER_SIZE;
+#endif
+
+	// Shrink to whole pages strictly inside the block's data area.
+	start = (char *)(((uintptr_t)start + pageSize - 1) & ~(pageSize - 1));
+	end = (char *)((uintptr_t)end & ~(pageSize - 1));
+	if (end <= start)
+		return;
+
+#ifdef MADV_FREE
+	// Lazy reclaim: the kernel only takes the pages under pressure, so a
+	// quick reuse pays nothing.
+	madvise(start, end - start, MADV_FREE);
+#else
+	madvise(start, end - start, MADV_DONTNEED);
+#endif
+}
+#endif
+
+static inline void deallocObject(Arena *arena, void *ptr)
+{
+	if (ptr == NULL) 
+		return;
+	
+	Header *currBlock = ptrToHeader(ptr);
+
+	// mmap'd blocks live outside the chunks and have no neighbors; hand
+	// them straight back to the OS. The boundary word holds the distance
+	// from the start of the mapping to the header (larger for aligned
+	// blocks).
+	if (getState(currBlock) == MMAPPED) {
+#ifdef MALLOC_HARDEN
+		_verifyHardened(currBlock);
+#endif
+#ifdef MALLOC_VALIDATE
+		_unregisterMmap(currBlock);
+#endif
+#ifdef MALLOC_FOOTERS
+		size_t gap = _getFooter(currBlock);
+		munmap((char *)currBlock - gap, getSize(currBlock) + gap);
+#else
+		munmap((char *)currBlock - currBlock -> leftSize,
+				getSize(currBlock) + currBlock -> leftSize);
+#endif
+		return;
+	}
+
+#ifdef MALLOC_HARDEN
+	// Validate before the neighbors are read, so a smashed header is
+	// reported rather than chased. Blocks already unallocated fall
+	// through to the double-free report below.
+	if (getState(currBlock) == ALLOCATED)
+		_verifyHardened(currBlock);
+#endif
+
+	/*
+	 * Both neighbor headers are needed below and both addresses fall out
+	 * of the header line just loaded, so issue their prefetches back to
+	 * back; otherwise the two state reads miss serially on top of the
+	 * header miss. Write-intent, as coalescing rewrites the neighbors.
+	 */
+	__builtin_prefetch(getRightHeader(currBlock), 1);
+#ifdef MALLOC_FOOTERS
+	// Only a free left neighbor has a readable footer (and header).
+	if (getLeftFree(currBlock))
+		__builtin_prefetch(getLeftHeader(currBlock), 1);
+#else
+	__builtin_prefetch(getLeftHeader(currBlock), 1);
+#endif
+
+	// Get a previous block and next block.
+#ifdef MALLOC_FOOTERS
+	/*
+	 * An allocated left neighbor lends its boundary word to its user data,
+	 * so its header is unreachable; the left-free flag says whether the
+	 * footer below this header can be trusted.
+	 */
+	Header *prevBlock = getLeftFree(currBlock) ? getLeftHeader(currBlock) : NULL;
+	Header *nextBlock = getRightHeader(currBlock);
+
+	State prevState = prevBlock != NULL ? UNALLOCATED : ALLOCATED;
+	State nextState = getState(nextBlock);
+#else
+	Header *prevBlock = getLeftHeader(currBlock);
+	Header *nextBlock = getRightHeader(currBlock);
+
+	// Get states for the previous block and the next block.
+	State prevState = getState(prevBlock);
+	State nextState = getState(nextBlock);
+#endif
+
+	// If the block has already been deallocated, freeing it again generates an error.
+	if (getState(currBlock) == UNALLOCATED) {
+		fprintf(stderr, "Double Free Detected\n");
+		fprintf(stderr, "Assertion Failed!\n");
+		exit(1);
+	}
+	
+	// Set the state of the current block unallocated. Its data area has
+	// been written by the user, so the memory is now recycled.
+	setState(currBlock, UNALLOCATED);
+	setRecycled(currBlock, true);
+	arena -> stats.frees++;
+	size_t size;
+	int index;
+	int newIndex;
+
+	// Both neighboring blocks are unallocated.
+	if (prevState == UNALLOCATED && nextState == UNALLOCATED) {
+		arena -> stats.coalesces += 2;
+		index = _getFreelistIndex(getSize(prevBlock));
+		// The next block is absorbed into the previous block, so unlink it.
+		_removeBlock(arena, nextBlock, _getFreelistIndex(getSize(nextBlock)));
+#ifdef MALLOC_INCREMENTAL
+		_unmarkDirty(nextBlock);
+#endif
+		size = getSize(prevBlock) + getSize(currBlock) + getSize(nextBlock);
+		// The previous block grows in place on its list.
+		arena -> freeBytesByClass[index] += size - getSize(prevBlock);
+		setSize(prevBlock, size);
+		setRecycled(prevBlock, true);
+
+#ifdef MALLOC_FOOTERS
+		_publishBlock(prevBlock);
+#else
+		Header *nextNextBlock = getRightHeader(nextBlock);
+		nextNextBlock -> leftSize = size;
+#endif
+
+		// If the coalseced size is not fit for the current freelist where the prevBlock is stored.
+		// Insert it into an appropriate freelist.
 		newIndex = _getFreelistIndex(getSize(prevBlock));
-		if (!_isSameIndex(index, newIndex))
-			_updateBlock(prevBlock);
+		if (_needsRehome(index, newIndex))
+			_updateBlock(arena, prevBlock, index);
+
+#ifdef MALLOC_INCREMENTAL
+		_markDirty(prevBlock);
+#endif
+#ifdef MALLOC_DECOMMIT
+		_decommitBlock(prevBlock);
+#endif
+
+	// Only the prev block is unallocated.
+	// Coalesce the current block and the previous block.
+	} else if (prevState == UNALLOCATED) {
+		arena -> stats.coalesces++;
+		index = _getFreelistIndex(getSize(prevBlock));
+		size = getSize(prevBlock) + getSize(currBlock);
+		// The previous block grows in place on its list.
+		arena -> freeBytesByClass[index] += size - getSize(prevBlock);
+		setSize(prevBlock, size);
+		setRecycled(prevBlock, true);
+#ifdef MALLOC_FOOTERS
+		_publishBlock(prevBlock);
+#else
+		nextBlock -> leftSize = size;
+#endif
+
+		// If the coalseced size is not fit for the freelist where the prevBlock is stored.
+		// Insert it into an appropriate freelist.
+		newIndex = _getFreelistIndex(getSize(prevBlock));
+		if (_needsRehome(index, newIndex))
+			_updateBlock(arena, prevBlock, index);
+
+#ifdef MALLOC_INCREMENTAL
+		_markDirty(prevBlock);
+#endif
+#ifdef MALLOC_DECOMMIT
+		_decommitBlock(prevBlock);
+#endif
 
 	// Only the next block is unallocated.
 	// Coalesce the current block and the next block.
 	} else if (nextState == UNALLOCATED) {
+		arena -> stats.coalesces++;
 		index = _getFreelistIndex(getSize(nextBlock));
-		size = getSize(nextBlock) + getSize(currBlock);	
+		size = getSize(nextBlock) + getSize(currBlock);
+		// The coalesced block takes the next block's list slot with the
+		// current block's bytes added.
+		arena -> freeBytesByClass[index] += size - getSize(nextBlock);
 		setSize(currBlock, size);
 
+#ifdef MALLOC_FOOTERS
+		_publishBlock(currBlock);
+#else
 		Header *nextNextBlock = getRightHeader(nextBlock);
 		nextNextBlock -> leftSize = size;
+#endif
+
+		// The coalesced block starts at the current block, so it takes over
+		// the next block's position in the freelist.
+		setNext(currBlock, getNext(nextBlock));
+		setPrev(currBlock, getPrev(nextBlock));
+		setPrev(getNext(currBlock), currBlock);
+		setNext(getPrev(currBlock), currBlock);
+
+#ifdef MALLOC_BESTFIT
+		// Mirror the takeover in the overflow trie, which still references
+		// the next block's node.
+		if (index == NUM_LISTS - 1) {
+			_trieRemove(arena, nextBlock);
+			_trieInsert(arena, currBlock);
+		}
+#endif
 
 		// If the coalseced size is not fit for the freelist where the nextBlock is stored.
 		// Insert it into an appropriate freelist.
+#ifdef MALLOC_INCREMENTAL
+		_unmarkDirty(nextBlock);
+#endif
+
 		newIndex = _getFreelistIndex(getSize(currBlock));
 		if (!_isSameIndex(index, newIndex))
-			_updateBlock(currBlock);
+			_updateBlock(arena, currBlock, index);
+
+#ifdef MALLOC_INCREMENTAL
+		_markDirty(currBlock);
+#endif
+#ifdef MALLOC_DECOMMIT
+		_decommitBlock(currBlock);
+#endif
 	
 	// Both neighboring blocks are allocated.
 	// Insert into an appropriate freelist.
 	} else {
-		_insertBlock(currBlock);	
+		_insertBlock(arena, currBlock);	
+
+#ifdef MALLOC_DECOMMIT
+		_decommitBlock(currBlock);
+#endif
 	}	
 }
 
@@ -541,10 +2308,10 @@ static inline void deallocObject(void *ptr)
 static inline Header *detectCycles()
 {
 	for (int i = 0; i < NUM_LISTS; i++) {
-    	Header *sentinel = &freelists[i];
-    	for (Header *slow = sentinel->next, *fast = sentinel -> next -> next; 
+    	Header *sentinel = &freelists[i].sentinel;
+    	for (Header *slow = getNext(sentinel), *fast = getNext(getNext(sentinel)); 
 			fast != sentinel; 
-			slow = slow -> next, fast = fast -> next -> next) {
+			slow = getNext(slow), fast = getNext(getNext(fast))) {
 			if (slow == fast)
         		return slow;
 		}
@@ -563,9 +2330,9 @@ static inline Header *detectCycles()
 static inline Header *verifyPointers()
 {
 	for (int i = 0; i < NUM_LISTS; i++) {
-    	Header *freelist = &freelists[i];
-    	for (Header *curr = freelist -> next; curr != freelist; curr = curr -> next) {
-      		if (curr -> next -> prev != curr || curr -> prev -> next != curr)
+    	Header *freelist = &freelists[i].sentinel;
+    	for (Header *curr = getNext(freelist); curr != freelist; curr = getNext(curr)) {
+      		if (getPrev(getNext(curr)) != curr || getNext(getPrev(curr)) != curr)
         		return curr;
     	}
   	}
@@ -584,7 +2351,7 @@ static inline bool verifyFreelist()
 	Header *cycle = detectCycles();
 	if (cycle != NULL) {
 		fprintf(stderr, "Cycle Detected\n");
-    	print_sublist(print_object, cycle -> next, cycle);
+    	print_sublist(print_object, getNext(cycle), cycle);
     	return false;
 	}
   
@@ -614,12 +2381,36 @@ static inline Header *verifyChunk(Header *chunk)
 		return chunk;
 	}
 	
-	for (; getState(chunk) != FENCEPOST; chunk = getRightHeader(chunk)) {
+	// Start past the first fencepost; beginning the walk on it made the
+	// loop condition false immediately and skipped the whole chunk.
+	for (chunk = getRightHeader(chunk); getState(chunk) != FENCEPOST; chunk = getRightHeader(chunk)) {
+#ifdef MALLOC_FOOTERS
+		// A free block is checked through the footer its right neighbor
+		// carries; an allocated block lends that word to user data, so
+		// only the neighbor's left-free flag can be checked against it.
+		Header *right = getRightHeader(chunk);
+		bool isFree = getState(chunk) == UNALLOCATED;
+		if (getLeftFree(right) != isFree ||
+				(isFree && _getFooter(right) != getSize(chunk))) {
+			fprintf(stderr, "Invalid sizes\n");
+			print_object(chunk);
+			return chunk;
+		}
+#else
 		if (getSize(chunk)  != getRightHeader(chunk) -> leftSize) {
 			fprintf(stderr, "Invalid sizes\n");
 			print_object(chunk);
 			return chunk;
 		}
+#endif
+
+#ifdef MALLOC_HARDEN
+		if (getState(chunk) == ALLOCATED && !_canaryIntact(chunk)) {
+			fprintf(stderr, "Invalid canary\n");
+			print_object(chunk);
+			return chunk;
+		}
+#endif
 	}
 	
 	return NULL;
@@ -634,86 +2425,1476 @@ static inline Header *verifyChunk(Header *chunk)
 static inline bool verifyTags()
 {
 	for (size_t i = 0; i < numChunks; i++) {
-		Header *invalid = verifyChunk(chunkList[i]);
-		if (invalid != NULL)
-			return invalid;
+		// The invalid header was already printed by verifyChunk; collapse
+		// it to the boolean the caller expects (returning the pointer
+		// through bool made the error path report success).
+		if (verifyChunk(chunkList[i]) != NULL)
+			return false;
 	}
 
-	return NULL;
+	return true;
 }
 
 /**
- * @brief Initialize mutex lock and prepare an initial chunk of memory for allocation.
+ * @brief Initialize the arenas and prepare an initial chunk of memory for allocation.
  */
 static void init()
 {
-	// Initialize mutex for thread safety
-  	pthread_mutex_init(&mutex, NULL);
+	/*
+	 * Set the emergency reserve aside before the first chunk so the heap
+	 * proper stays contiguous above it; until released during OOM it is
+	 * raw memory outside the chunk index. Startup without room for the
+	 * reserve simply runs without one.
+	 */
+	emergencyReserve = sbrk(ARENA_SIZE);
+	if (emergencyReserve == (void *)-1)
+		emergencyReserve = NULL;
+
+#ifdef MALLOC_COMPACT
+	/*
+	 * Compact links are encoded relative to base, so it must be valid
+	 * before the first sentinel is linked. sbrk(0) is exactly where the
+	 * first chunk's fencepost will land, matching the assignment below.
+	 */
+	base = sbrk(0);
+#endif
+
+	// Initialize each arena's mutex and freelist sentinels for thread safety.
+	for (int a = 0; a < MALLOC_ARENAS; a++) {
+		Arena *arena = &arenas[a];
+		pthread_mutex_init(&arena -> mutex, NULL);
+		arena -> nextChunkSize = ARENA_SIZE;
+#if MALLOC_ARENAS > 1
+		arena -> freelists = a == 0 ? freelists : extraFreelists[a - 1];
+		arena -> freelistBitmap = a == 0 ? freelistBitmap : extraFreelistBitmaps[a - 1];
+#else
+		arena -> freelists = freelists;
+		arena -> freelistBitmap = freelistBitmap;
+#endif
+		for (int i = 0; i < NUM_LISTS; i++) {
+			Header *sentinel = &arena -> freelists[i].sentinel;
+			setNext(sentinel, sentinel);
+			setPrev(sentinel, sentinel);
+		}
+	}
 
 #ifdef DEBUG
   	// Manually set printf buffer so it won't call malloc when debugging the allocator.
   	setvbuf(stdout, NULL, _IONBF, 0);
 #endif // DEBUG
 
-	// Allocate the first chunk from the OS
+	// Allocate the first chunk from the OS for the primary arena.
   	Header *block = allocChunk(ARENA_SIZE);
+	// No room for even one chunk: leave the freelists empty and let the
+	// first allocation fall back to the reserve or fail with ENOMEM.
+	if (block == NULL)
+		return;
   	// Compute the address of the previous fencepost.
   	Header *prevFencepost = getHeaderFromOffset(block, -ALLOC_HEADER_SIZE);
   	// Insert a newly allocated memory chuck by the OS into the list of chunks.
-  	insertChunk(prevFencepost);
+  	insertChunk(&arenas[0], prevFencepost);
   	// Get the last fencepost of the chunk.
-  	lastFencepost = getHeaderFromOffset(block, getSize(block));
+  	arenas[0].lastFencepost = getHeaderFromOffset(block, getSize(block));
 
   	// Set the base pointer to the beginning of the first fencepost in the first
   	// chunk from the OS.
   	base = ((char *)block) - ALLOC_HEADER_SIZE; //sizeof(Header);
 
-  	// Initialize freelist sentinels.
-  	for (int i = 0; i < NUM_LISTS; i++) {
-		Header *sentinel = &freelists[i];
-    	sentinel -> next = sentinel;
-    	sentinel -> prev = sentinel;
-	}
-
   	// Insert the first chunk into a free list.
-  	Header *sentinel = &freelists[NUM_LISTS - 1];
-  	sentinel -> next = block;
-  	sentinel -> prev = block;
-  	block -> next = sentinel;
-  	block -> prev = sentinel;
+  	_insertBlock(&arenas[0], block);
 }
 
 void *myMalloc(size_t size)
 {
-	pthread_mutex_lock(&mutex);
-	Header *block = allocObject(size);
-	pthread_mutex_unlock(&mutex);
+#ifdef MALLOC_PROFILE
+	if (size != 0)
+		_profileSample(size);
+#endif
+
+	// Requests too large for a single chunk go straight to mmap, skipping
+	// the lock-protected freelist machinery entirely.
+	if (size != 0 && _calcActualSize(size) > MMAP_THRESHOLD)
+		return mmapObject(_calcActualSize(size));
+
+#ifdef MALLOC_MAGAZINES
+	// Pop from the thread-local magazine with no locking. Classes below the
+	// final list hold exactly one size, so the cached block is an exact fit.
+	if (size != 0) {
+		int index = _getFreelistIndex(_calcActualSize(size));
+#ifdef MALLOC_SIZECLASSES
+		// Geometric classes hold ranges, so only linear classes cache.
+		if (index < NUM_LINEAR_LISTS && magazines[index] != NULL) {
+#else
+		if (index < NUM_LISTS - 1 && magazines[index] != NULL) {
+#endif
+			Header *hdr = magazines[index];
+			magazines[index] = *(Header **)hdr -> data;
+			magazineCounts[index]--;
+			return hdr -> data;
+		}
+	}
+#endif
+
+#ifdef MALLOC_SHARDS
+	Arena *arena = size == 0 ? getArena() : getShardArena(_calcActualSize(size));
+#else
+	Arena *arena = getArena();
+#endif
+
+	pthread_mutex_lock(&arena -> mutex);
+	Header *block = allocObject(arena, size);
+	pthread_mutex_unlock(&arena -> mutex);
 
 	return block;
 }
 
 void *myCalloc(size_t nmemb, size_t size)
 {
-	return memset(myMalloc(size * nmemb), 0, size * nmemb);
+	// Guard against nmemb * size overflowing.
+	if (size != 0 && nmemb > SIZE_MAX / size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	size_t bytes = nmemb * size;
+	void *mem = myMalloc(bytes);
+	if (mem == NULL)
+		return NULL;
+
+	/*
+	 * Memory that has never been recycled is still zero from the OS; only
+	 * the freelist pointers kept in the first bytes of the data area may
+	 * have been written, so zeroing those is enough. Anything that writes
+	 * deeper into a free block's data area (e.g. _trieInsert storing its
+	 * TrieNode there) must mark the block recycled to opt out of this.
+	 */
+	if (!getRecycled(ptrToHeader(mem))) {
+		size_t dirty = 2 * sizeof(Header *);
+		return memset(mem, 0, bytes < dirty ? bytes : dirty);
+	}
+
+	return memset(mem, 0, bytes);
+}
+
+/*
+ * @brief Grow a block sitting at the heap frontier by moving the break.
+ *
+ * Called with the arena mutex held. When the block's right neighbor is
+ * the arena's last fencepost and that fencepost still sits at the
+ * program break, the chunk can be extended with sbrk and the fencepost
+ * pushed right, growing the block with no copy at all. Repeatedly
+ * doubled buffers then grow in O(1) amortized with zero memcpy traffic.
+ *
+ * @param arena the arena that owns the block,
+ *        hdr a header, needed the number of additional bytes
+ *
+ * @return True if the block was extended by needed bytes
+ */
+static bool _extendFrontier(Arena *arena, Header *hdr, size_t needed)
+{
+	Header *fencepost = getRightHeader(hdr);
+	if (fencepost != arena -> lastFencepost)
+		return false;
+
+	pthread_mutex_lock(&chunkMutex);
+	// Another arena (or the chunk index) may have moved the break since
+	// this chunk was cut; extending then would grow a foreign region.
+	if (sbrk(0) != (char *)fencepost + ALLOC_HEADER_SIZE ||
+	    sbrk(needed) == (void *)-1) {
+		pthread_mutex_unlock(&chunkMutex);
+		return false;
+	}
+	statHeapBytes += needed;
+#ifdef MALLOC_VALIDATE
+	heapEnd = (char *)fencepost + ALLOC_HEADER_SIZE + needed;
+#endif
+	pthread_mutex_unlock(&chunkMutex);
+
+	// Absorb the new bytes and re-seat the fencepost after them.
+	setSize(hdr, getSize(hdr) + needed);
+	initFencepost(getRightHeader(hdr), getSize(hdr));
+#ifdef MALLOC_FOOTERS
+	_publishBlock(hdr);
+#endif
+	arena -> lastFencepost = getRightHeader(hdr);
+	return true;
+}
+
+/*
+ * @brief Resize a block in place when its layout allows it.
+ *
+ * Shrinks split the tail off as a free block (reusing the split rules of
+ * _allocBlock) and grows absorb a large enough unallocated right neighbor
+ * or extend the heap frontier, so the common resize patterns become pure
+ * metadata updates.
+ *
+ * @param arena the arena whose freelists hold the block's neighbors,
+ *        hdr a header, actualSize the new actual size of the block
+ *
+ * @return True if the block now holds actualSize bytes, false otherwise
+ */
+static bool _reallocInPlace(Arena *arena, Header *hdr, size_t actualSize)
+{
+	size_t currSize = getSize(hdr);
+
+	// Grow into the right neighbor when it is free and large enough.
+	if (actualSize > currSize) {
+		Header *nextBlock = getRightHeader(hdr);
+
+		// The last block before the frontier grows without any neighbor.
+		if (_extendFrontier(arena, hdr, actualSize - currSize)) {
+#ifdef MALLOC_HARDEN
+			_stampCanary(hdr);
+#endif
+			return true;
+		}
+
+		if (getState(nextBlock) != UNALLOCATED || currSize + getSize(nextBlock) < actualSize)
+			return false;
+
+		_removeBlock(arena, nextBlock, _getFreelistIndex(getSize(nextBlock)));
+#ifdef MALLOC_INCREMENTAL
+		_unmarkDirty(nextBlock);
+#endif
+		setSize(hdr, currSize + getSize(nextBlock));
+#ifdef MALLOC_FOOTERS
+		// The grown block is allocated, so its new right neighbor's
+		// left-free flag comes down.
+		_publishBlock(hdr);
+#else
+		getRightHeader(hdr) -> leftSize = getSize(hdr);
+#endif
+		currSize = getSize(hdr);
+	}
+
+	// Split the tail off as a free block when enough slack remains.
+	if (currSize - actualSize >= MIN_SPLIT_SIZE) {
+		setSize(hdr, actualSize);
+
+		Header *rest = getRightHeader(hdr);
+		setSizeAndState(rest, currSize - actualSize, ALLOCATED);
+		setRecycled(rest, true);
+#ifndef MALLOC_FOOTERS
+		rest -> leftSize = actualSize;
+		getRightHeader(rest) -> leftSize = getSize(rest);
+#endif
+
+#ifdef MALLOC_HARDEN
+		// After a grow the tail's end may lie in absorbed memory with no
+		// valid canary; stamp it before the free path verifies it.
+		_stampCanary(rest);
+#endif
+		// Free the tail so it coalesces and lands in the right freelist.
+		deallocObject(arena, rest -> data);
+	}
+
+#ifdef MALLOC_HARDEN
+	_stampCanary(hdr);
+#endif
+	return true;
+}
+
+/*
+ * @brief Report the usable size of an allocated block.
+ *
+ * Blocks may be larger than requested when the allocator declined to
+ * split the slack off (remainder below the split threshold), so callers
+ * growing buffers incrementally can fill the slack before reallocating.
+ *
+ * @param ptr pointer to the data region of the block, or NULL
+ *
+ * @return The number of bytes usable through ptr, 0 for NULL
+ */
+size_t myMallocUsableSize(void *ptr)
+{
+	if (ptr == NULL)
+		return 0;
+
+	size_t usable = getSize(ptrToHeader(ptr)) - ALLOC_HEADER_SIZE;
+#ifdef MALLOC_HARDEN
+	// The trailing canary is not the caller's to write.
+	usable -= CANARY_SIZE;
+#endif
+	return usable;
 }
 
 void *myRealloc(void *ptr, size_t size)
 {
+	if (ptr == NULL)
+		return myMalloc(size);
+
+	if (size == 0) {
+		myFree(ptr);
+		return NULL;
+	}
+
+#ifdef MALLOC_VALIDATE
+	if (!_validPointer(ptr)) {
+		fprintf(stderr, "myRealloc: invalid pointer %p\n", ptr);
+		errno = EINVAL;
+		return NULL;
+	}
+#endif
+
+	Header *hdr = ptrToHeader(ptr);
+	size_t actualSize = _calcActualSize(size);
+
+	// mmap'd blocks already own whole pages; keep the mapping when the new
+	// size still fits.
+	if (getState(hdr) == MMAPPED) {
+		if (actualSize <= getSize(hdr))
+			return ptr;
+	} else if (actualSize <= MMAP_THRESHOLD) {
+		size_t currSize = getSize(hdr);
+
+		// The new size already fits in the block's usable bytes and the
+		// slack is too small to give back: the block is unchanged, so skip
+		// the lock entirely.
+		if (actualSize <= currSize && currSize - actualSize < MIN_SPLIT_SIZE)
+			return ptr;
+
+#if MALLOC_ARENAS > 1
+		Arena *arena = findBlockArena(hdr);
+#else
+		Arena *arena = getArena();
+#endif
+		pthread_mutex_lock(&arena -> mutex);
+		bool resized = _reallocInPlace(arena, hdr, actualSize);
+		pthread_mutex_unlock(&arena -> mutex);
+
+		if (resized)
+			return ptr;
+	}
+
+	// Fall back to allocate, copy, free. Copy only the bytes that exist in
+	// the old block rather than reading past its end when growing.
 	void *reallocMem = myMalloc(size);
-	memcpy(reallocMem, ptr, size);
+	if (reallocMem == NULL)
+		return NULL;
+
+	size_t oldDataSize = getSize(hdr) - ALLOC_HEADER_SIZE;
+	memcpy(reallocMem, ptr, size < oldDataSize ? size : oldDataSize);
 	myFree(ptr);
 
 	return reallocMem;
 }
 
-void myFree(void *ptr)
+/*
+ * @brief Allocate size bytes whose address is a multiple of alignment.
+ *
+ * The request is padded so an aligned position always exists with room
+ * for a whole free block of leading slack; the slack is given back to
+ * the freelists as a proper boundary-tagged block (and any tail slack is
+ * split off the same way), so nothing is wasted and myFree works on the
+ * aligned pointer like any other.
+ *
+ * @param alignment The required alignment, a power of two
+ * @param size Number of bytes to allocate
+ *
+ * @return An aligned pointer, or NULL with errno set on bad alignment
+ */
+void *myMemalign(size_t alignment, size_t size)
 {
-	pthread_mutex_lock(&mutex);
-	deallocObject(ptr);
-	pthread_mutex_unlock(&mutex);
-}
+	// Alignment must be a power of two.
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+		errno = EINVAL;
+		return NULL;
+	}
 
-bool verify()
-{
-	return verifyFreelist() && verifyTags();
-}
+	// Every block's data area is already 8-byte aligned.
+	if (alignment <= MIN_ALLOCATION || size == 0)
+		return myMalloc(size);
+
+	size_t actualSize = _calcActualSize(size);
+	// Worst case the aligned position sits alignment - 1 bytes in, and the
+	// leading slack must be large enough to stand as its own free block.
+	size_t padded = actualSize + alignment + UNALLOC_HEADER_SIZE;
+
+	// Large aligned requests go to mmap; the gap between the mapping and
+	// the aligned header is recorded in the boundary word so deallocObject
+	// can unmap the whole region.
+	if (padded > MMAP_THRESHOLD) {
+		size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+		size_t mapSize = (actualSize + alignment + pageSize - 1) & ~(pageSize - 1);
+
+		char *mem = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED)
+			return NULL;
+
+		__atomic_fetch_add(&statMmaps, 1, __ATOMIC_RELAXED);
+
+		char *aligned = (char *)(((uintptr_t)(mem + ALLOC_HEADER_SIZE) + alignment - 1) & ~(alignment - 1));
+		Header *hdr = ptrToHeader(aligned);
+		setSizeAndState(hdr, mapSize - ((char *)hdr - mem), MMAPPED);
+#ifdef MALLOC_FOOTERS
+		*((size_t *)hdr - 1) = (char *)hdr - mem;
+#else
+		hdr -> leftSize = (char *)hdr - mem;
+#endif
+
+#ifdef MALLOC_HARDEN
+		_stampCanary(hdr);
+#endif
+#ifdef MALLOC_VALIDATE
+		_registerMmap(hdr);
+#endif
+
+		return aligned;
+	}
+
+#ifdef MALLOC_SHARDS
+	Arena *arena = getShardArena(padded);
+#else
+	Arena *arena = getArena();
+#endif
+
+	pthread_mutex_lock(&arena -> mutex);
+	Header *mem = allocObject(arena, padded - ALLOC_HEADER_SIZE);
+	if (mem == NULL) {
+		pthread_mutex_unlock(&arena -> mutex);
+		return NULL;
+	}
+
+	Header *hdr = ptrToHeader(mem);
+	char *aligned = (char *)(((uintptr_t)(hdr -> data) + alignment - 1) & ~(alignment - 1));
+
+	// Carve the leading slack off as its own free block. If the data area
+	// happened to be aligned there is no slack; otherwise step forward
+	// until the slack can hold a whole unallocated header.
+	if (aligned != (char *)(hdr -> data)) {
+		while ((size_t)(aligned - ALLOC_HEADER_SIZE - (char *)hdr) < MIN_SPLIT_SIZE)
+			aligned += alignment;
+
+		Header *alignedHdr = ptrToHeader(aligned);
+		size_t leadingSize = (char *)alignedHdr - (char *)hdr;
+
+		setSizeAndState(alignedHdr, getSize(hdr) - leadingSize, ALLOCATED);
+		setRecycled(alignedHdr, getRecycled(hdr));
+#ifndef MALLOC_FOOTERS
+		// Freeing the slack below publishes the footer-layout tags.
+		alignedHdr -> leftSize = leadingSize;
+		getRightHeader(alignedHdr) -> leftSize = getSize(alignedHdr);
+#endif
+
+		setSize(hdr, leadingSize);
+#ifdef MALLOC_HARDEN
+		// The slack becomes a block of its own; give it the canary the
+		// free path expects.
+		_stampCanary(hdr);
+#endif
+		deallocObject(arena, hdr -> data);
+
+		hdr = alignedHdr;
+	}
+
+	// Split any tail slack off as a free block as well.
+	if (getSize(hdr) - actualSize >= MIN_SPLIT_SIZE) {
+		size_t restSize = getSize(hdr) - actualSize;
+
+		setSize(hdr, actualSize);
+
+		Header *rest = getRightHeader(hdr);
+		setSizeAndState(rest, restSize, ALLOCATED);
+		setRecycled(rest, true);
+#ifndef MALLOC_FOOTERS
+		rest -> leftSize = actualSize;
+		getRightHeader(rest) -> leftSize = restSize;
+#endif
+
+#ifdef MALLOC_HARDEN
+		_stampCanary(rest);
+#endif
+		deallocObject(arena, rest -> data);
+	}
+#ifdef MALLOC_HARDEN
+	_stampCanary(hdr);
+#endif
+	pthread_mutex_unlock(&arena -> mutex);
+
+	return hdr -> data;
+}
+
+/*
+ * @brief Allocate size bytes whose pages live on a specific NUMA node.
+ *
+ * Page placement is page-granular, so the block comes from its own
+ * mapping regardless of size and its pages are bound to the node with
+ * MPOL_BIND; it is freed through myFree like any other mmap'd block.
+ * Without -DMALLOC_NUMA the node is ignored and the request falls
+ * through to myMalloc.
+ *
+ * @param size Number of bytes to allocate
+ * @param node The NUMA node the block's pages must live on
+ *
+ * @return A pointer to the allocated memory, or NULL on failure
+ */
+void *myMallocOnNode(size_t size, int node)
+{
+#ifdef MALLOC_NUMA
+	if (size == 0)
+		return NULL;
+
+	void *mem = mmapObject(_calcActualSize(size));
+	if (mem != NULL) {
+		Header *hdr = ptrToHeader(mem);
+#ifdef MALLOC_FOOTERS
+		// The mapping starts a gap word before the header.
+		size_t gap = _getFooter(hdr);
+#else
+		size_t gap = 0;
+#endif
+		_bindToNode((char *)hdr - gap, getSize(hdr) + gap, node, MPOL_BIND);
+	}
+	return mem;
+#else
+	(void)node;
+	return myMalloc(size);
+#endif
+}
+
+/*
+ * @brief Allocate n blocks of the same size, taking the arena lock once.
+ *
+ * Runs of blocks are carved out of one contiguous allocation, so a burst
+ * of n identical requests costs one lock acquisition and a handful of
+ * freelist operations instead of n of each. Each carved block gets its
+ * own boundary tags, so the blocks are ordinary allocations that can be
+ * freed individually through myFree.
+ *
+ * @param size Number of bytes per block, n number of blocks,
+ *        out array that receives the n pointers
+ *
+ * @return The number of blocks allocated (less than n only when the OS
+ *         refuses more memory)
+ */
+size_t myMallocBatch(size_t size, size_t n, void **out)
+{
+	if (size == 0 || n == 0)
+		return 0;
+
+	size_t actualSize = _calcActualSize(size);
+
+	// Blocks that would be mmap'd individually gain nothing from carving.
+	if (actualSize > MMAP_THRESHOLD) {
+		for (size_t i = 0; i < n; i++) {
+			out[i] = myMalloc(size);
+			if (out[i] == NULL)
+				return i;
+		}
+		return n;
+	}
+
+	// Largest number of blocks one freelist allocation can be asked for.
+	size_t maxRun = MMAP_THRESHOLD / actualSize;
+	if (maxRun == 0)
+		maxRun = 1;
+
+#ifdef MALLOC_SHARDS
+	Arena *arena = getShardArena(actualSize);
+#else
+	Arena *arena = getArena();
+#endif
+	size_t i = 0;
+
+	pthread_mutex_lock(&arena -> mutex);
+	while (i < n) {
+		size_t run = n - i < maxRun ? n - i : maxRun;
+
+		Header *mem = allocObject(arena, run * actualSize - ALLOC_HEADER_SIZE);
+		if (mem == NULL)
+			break;
+
+		/*
+		 * Carve the run into blocks of actualSize. The allocation can be
+		 * slightly larger than requested when splitting would have left a
+		 * sliver; the last block absorbs the difference.
+		 */
+		Header *hdr = ptrToHeader(mem);
+		size_t remaining = getSize(hdr);
+		bool recycled = getRecycled(hdr);
+#ifdef MALLOC_FOOTERS
+		// Only the first carved block can have a free left neighbor; its
+		// flag must survive the size word being rewritten.
+		bool leftFree = getLeftFree(hdr);
+#else
+		Header *right = getRightHeader(hdr);
+		size_t leftSize = hdr -> leftSize;
+#endif
+
+		for (size_t k = 0; k < run; k++) {
+			size_t blockSize = k == run - 1 ? remaining : actualSize;
+
+			setSizeAndState(hdr, blockSize, ALLOCATED);
+			setRecycled(hdr, recycled);
+#ifdef MALLOC_FOOTERS
+			setLeftFree(hdr, leftFree);
+			leftFree = false;
+#else
+			hdr -> leftSize = leftSize;
+#endif
+
+#ifdef MALLOC_HARDEN
+			_stampCanary(hdr);
+#endif
+			out[i++] = hdr -> data;
+			remaining -= blockSize;
+#ifndef MALLOC_FOOTERS
+			leftSize = blockSize;
+#endif
+			hdr = getRightHeader(hdr);
+		}
+#ifndef MALLOC_FOOTERS
+		right -> leftSize = leftSize;
+#endif
+
+		// allocObject counted the carve as one allocation.
+		arena -> stats.mallocs += run - 1;
+	}
+	pthread_mutex_unlock(&arena -> mutex);
+
+	return i;
+}
+
+/*
+ * @brief Free n blocks, taking the arena lock once.
+ *
+ * NULL entries are skipped, so the array from a partially successful
+ * myMallocBatch can be handed back as is.
+ *
+ * @param ptrs Array of n pointers to free, n number of pointers
+ */
+void myFreeBatch(void **ptrs, size_t n)
+{
+#if MALLOC_ARENAS > 1
+	/*
+	 * Blocks in one batch can belong to different arenas (or to none, for
+	 * mmap'd blocks), so a single-lock pass is unsound here; the remote
+	 * free stacks already batch the cross-arena hand-off.
+	 */
+	for (size_t i = 0; i < n; i++) {
+#ifdef MALLOC_VALIDATE
+		if (ptrs[i] != NULL && !_validPointer(ptrs[i])) {
+			fprintf(stderr, "myFreeBatch: invalid pointer %p\n", ptrs[i]);
+			continue;
+		}
+#endif
+		if (ptrs[i] != NULL)
+			_freeToArena(ptrs[i]);
+	}
+#else
+	Arena *arena = getArena();
+
+	pthread_mutex_lock(&arena -> mutex);
+	for (size_t i = 0; i < n; i++) {
+#ifdef MALLOC_VALIDATE
+		if (ptrs[i] != NULL && !_validPointer(ptrs[i])) {
+			fprintf(stderr, "myFreeBatch: invalid pointer %p\n", ptrs[i]);
+			continue;
+		}
+#endif
+		if (ptrs[i] != NULL)
+			deallocObject(arena, ptrs[i]);
+	}
+	pthread_mutex_unlock(&arena -> mutex);
+#endif
+}
+
+/*
+ * Region/scratch allocator. A region owns dedicated chunks obtained
+ * through allocChunk; the fenceposts isolate them from the freelist
+ * chunks exactly as they isolate those from each other, and region
+ * chunks are kept out of chunkList so the debugging walks and the
+ * block-to-arena mapping never see them. Allocation is a bump pointer
+ * with no locking or per-block headers, so a region must not be shared
+ * between threads without external synchronization.
+ *
+ * The bookkeeping lives inside the chunks themselves: the first chunk's
+ * data area starts with the Region followed by its RegionChunk, and each
+ * later chunk starts with just a RegionChunk.
+ */
+typedef struct _RegionChunk {
+	struct _RegionChunk *next;
+	// The chunk's single payload block, for donation on destroy
+	Header *block;
+	// First byte handed out from this chunk
+	char *start;
+	// One past the last usable byte
+	char *end;
+} RegionChunk;
+
+struct _Region {
+	// Chunks in allocation order; reused in order after a reset
+	RegionChunk *chunks;
+	// Chunk currently being bumped
+	RegionChunk *current;
+	// Next free byte in the current chunk
+	char *bump;
+};
+
+/*
+ * @brief Helper to dedicate a fresh chunk to a region.
+ *
+ * @param size Number of usable bytes the chunk must provide
+ *
+ * @return The chunk's RegionChunk, placed at the start of its data area
+ */
+static RegionChunk *_regionChunkCreate(size_t size)
+{
+	// Round the OS request up to a multiple of ARENA_SIZE that leaves
+	// room for the fenceposts, the block header, and the bookkeeping.
+	size_t chunkSize = ARENA_SIZE;
+	while (chunkSize < size + sizeof(RegionChunk) + 4 * ALLOC_HEADER_SIZE)
+		chunkSize += ARENA_SIZE;
+
+	Header *block = allocChunk(chunkSize);
+	if (block == NULL)
+		return NULL;
+	setState(block, ALLOCATED);
+
+	RegionChunk *chunk = (RegionChunk *)block -> data;
+	chunk -> next = NULL;
+	chunk -> block = block;
+	chunk -> start = (char *)(chunk + 1);
+	chunk -> end = (char *)block + getSize(block);
+
+	return chunk;
+}
+
+/*
+ * @brief Create a region backed by one dedicated chunk.
+ *
+ * @return The new region
+ */
+Region *myRegionCreate()
+{
+	RegionChunk *chunk = _regionChunkCreate(sizeof(struct _Region));
+	if (chunk == NULL)
+		return NULL;
+
+	// The Region sits in front of the first chunk's RegionChunk; move the
+	// bookkeeping up to make room for it.
+	struct _Region *region = (struct _Region *)chunk;
+	RegionChunk moved = *chunk;
+	chunk = (RegionChunk *)(region + 1);
+	*chunk = moved;
+	chunk -> start = (char *)(chunk + 1);
+
+	region -> chunks = chunk;
+	region -> current = chunk;
+	region -> bump = chunk -> start;
+
+	return region;
+}
+
+/*
+ * @brief Bump-allocate size bytes from a region.
+ *
+ * @param region The region to allocate from, size number of bytes
+ *
+ * @return An 8-byte aligned pointer valid until the next reset or destroy
+ */
+void *myRegionAlloc(Region *region, size_t size)
+{
+	size = (size + MULTIPLE_8 - 1) & ~(size_t)(MULTIPLE_8 - 1);
+
+	while ((size_t)(region -> current -> end - region -> bump) < size) {
+		// Move on to the next retained chunk, or dedicate a new one.
+		if (region -> current -> next == NULL) {
+			region -> current -> next = _regionChunkCreate(size);
+			if (region -> current -> next == NULL)
+				return NULL;
+		}
+		region -> current = region -> current -> next;
+		region -> bump = region -> current -> start;
+	}
+
+	char *mem = region -> bump;
+	region -> bump += size;
+	return mem;
+}
+
+/*
+ * @brief Reclaim every allocation in the region at once.
+ *
+ * The chunks are retained for reuse, so a region that services the same
+ * workload repeatedly stops paying for chunk allocation entirely.
+ *
+ * @param region The region to reset
+ */
+void myRegionReset(Region *region)
+{
+	region -> current = region -> chunks;
+	region -> bump = region -> current -> start;
+}
+
+/*
+ * @brief Destroy a region, donating its chunks to the freelists.
+ *
+ * sbrk memory cannot be returned to the OS, so each chunk's payload
+ * block is entered into the chunk list and freelists of the calling
+ * thread's arena, where ordinary allocations can reuse it.
+ *
+ * @param region The region to destroy
+ */
+void myRegionDestroy(Region *region)
+{
+	Arena *arena = getArena();
+
+	pthread_mutex_lock(&arena -> mutex);
+	for (RegionChunk *chunk = region -> chunks; chunk != NULL;) {
+		// The bookkeeping lives in the donated memory; read it before the
+		// freelist links overwrite the start of the data area.
+		RegionChunk *next = chunk -> next;
+		Header *block = chunk -> block;
+
+		// The chunk's first fencepost sits one allocated header below the
+		// donated block.
+		insertChunk(arena, getHeaderFromOffset(block, -ALLOC_HEADER_SIZE));
+		setState(block, UNALLOCATED);
+		setRecycled(block, true);
+		_insertBlock(arena, block);
+
+		chunk = next;
+	}
+	pthread_mutex_unlock(&arena -> mutex);
+}
+
+/*
+ * @brief Free a block through the locked freelist machinery of its arena.
+ *
+ * @param ptr pointer to the data region of the block
+ */
+static void _freeToArena(void *ptr)
+{
+#if MALLOC_ARENAS > 1
+	// Route the free to the arena whose freelists hold the block's neighbors.
+	Arena *arena = ptr == NULL ? getArena() : findBlockArena(ptrToHeader(ptr));
+
+	/*
+	 * A block owned by another thread's arena is pushed onto that arena's
+	 * remote-free stack instead of stalling on its mutex; the owner frees
+	 * it for real on its next allocation. Double frees are still caught
+	 * then, just one allocation later.
+	 */
+	if (ptr != NULL && arena != getArena()) {
+		Header *hdr = ptrToHeader(ptr);
+		Header *head = __atomic_load_n(&arena -> remoteFrees, __ATOMIC_RELAXED);
+
+		do {
+			*(Header **)hdr -> data = head;
+		} while (!__atomic_compare_exchange_n(&arena -> remoteFrees, &head, hdr,
+				false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+		return;
+	}
+#else
+	Arena *arena = getArena();
+#endif
+
+#ifdef MALLOC_DEFERRED
+	// Defer the free: push the block onto the arena's quick list without
+	// touching its neighbors, leaving the coalescing work for one batched
+	// pass in myMallocConsolidate. mmap'd blocks have no neighbors to
+	// coalesce with and are returned to the OS right away.
+	if (ptr != NULL && getState(ptrToHeader(ptr)) == ALLOCATED) {
+		Header *hdr = ptrToHeader(ptr);
+
+		pthread_mutex_lock(&arena -> mutex);
+#ifdef MALLOC_HARDEN
+		// The block skips deallocObject until consolidation, so check
+		// it here while the free is still attributable to the caller.
+		_verifyHardened(hdr);
+#endif
+		setRecycled(hdr, true);
+		*(Header **)hdr -> data = arena -> quickList;
+		arena -> quickList = hdr;
+		pthread_mutex_unlock(&arena -> mutex);
+
+		return;
+	}
+#endif
+
+	pthread_mutex_lock(&arena -> mutex);
+	deallocObject(arena, ptr);
+	pthread_mutex_unlock(&arena -> mutex);
+}
+
+#ifdef MALLOC_DEFERRED
+/*
+ * @brief Coalesce every deferred free of an arena in one batch.
+ *
+ * Called with the arena mutex held. Each block runs through the normal
+ * deallocObject path, so deferred neighbors freed in any order still end
+ * up merged once the batch completes.
+ *
+ * @param arena the arena whose quick list to consolidate
+ */
+static void _consolidateArena(Arena *arena)
+{
+	Header *hdr = arena -> quickList;
+	arena -> quickList = NULL;
+
+	while (hdr != NULL) {
+		Header *next = *(Header **)hdr -> data;
+		deallocObject(arena, hdr -> data);
+		hdr = next;
+	}
+}
+#endif
+
+/*
+ * @brief Aggregate the runtime counters of every arena.
+ *
+ * Counters are only summed when queried, so the allocation and free hot
+ * paths pay nothing beyond the plain increments they already do under
+ * their arena mutex.
+ *
+ * @param out Receives the summed counters of all arenas
+ */
+void myMallocStats(MallocStats *out)
+{
+	memset(out, 0, sizeof(*out));
+
+	for (int a = 0; a < MALLOC_ARENAS; a++) {
+		Arena *arena = &arenas[a];
+
+		pthread_mutex_lock(&arena -> mutex);
+		out -> mallocs += arena -> stats.mallocs;
+		out -> frees += arena -> stats.frees;
+		out -> splits += arena -> stats.splits;
+		out -> coalesces += arena -> stats.coalesces;
+		out -> searchSteps += arena -> stats.searchSteps;
+		pthread_mutex_unlock(&arena -> mutex);
+	}
+
+	pthread_mutex_lock(&chunkMutex);
+	out -> chunks = statChunks;
+	pthread_mutex_unlock(&chunkMutex);
+	out -> mmaps = __atomic_load_n(&statMmaps, __ATOMIC_RELAXED);
+}
+
+/*
+ * @brief Report heap occupancy and fragmentation metrics.
+ *
+ * Sums the per-class byte counters the freelist insert, remove, and
+ * in-place resize paths already maintain, so polling costs
+ * O(arenas * lists) with no heap walk. Only the largest-free-block probe
+ * touches blocks, and only those on the one highest non-empty list per
+ * arena. Blocks parked in thread-local magazines or on deferred quick
+ * lists count as allocated until they reach the freelists.
+ *
+ * @param out Receives the metrics
+ */
+void myMallocHeapInfo(HeapInfo *out)
+{
+	memset(out, 0, sizeof(*out));
+
+	for (int a = 0; a < MALLOC_ARENAS; a++) {
+		Arena *arena = &arenas[a];
+
+		pthread_mutex_lock(&arena -> mutex);
+		for (int i = 0; i < NUM_LISTS; i++) {
+			out -> freeBytesByClass[i] += arena -> freeBytesByClass[i];
+			out -> freeBytes += arena -> freeBytesByClass[i];
+		}
+
+		// The largest free block sits on the highest non-empty list; walk
+		// just that list, as the final lists hold more than one size.
+		for (int i = NUM_LISTS - 1; i >= 0; i--) {
+			Header *sentinel = &arena -> freelists[i].sentinel;
+			if (_isEmptyFreelist(sentinel))
+				continue;
+			for (Header *curr = getNext(sentinel); curr != sentinel; curr = getNext(curr)) {
+				if (getSize(curr) > out -> largestFreeBlock)
+					out -> largestFreeBlock = getSize(curr);
+			}
+			break;
+		}
+		pthread_mutex_unlock(&arena -> mutex);
+	}
+
+	pthread_mutex_lock(&chunkMutex);
+	out -> heapBytes = statHeapBytes;
+	out -> chunks = statChunks;
+	pthread_mutex_unlock(&chunkMutex);
+	out -> allocatedBytes = out -> heapBytes - out -> freeBytes;
+}
+
+/*
+ * @brief Write the collected heap samples as a pprof heap profile.
+ *
+ * Samples with identical stacks are folded into one stanza; the process
+ * mappings are appended so pprof can symbolize the raw addresses. The
+ * heap_v2 header carries the sampling interval, letting pprof scale the
+ * sampled byte counts back up to estimates of the real footprint. A
+ * no-op in builds without -DMALLOC_PROFILE.
+ *
+ * @param path the file to write the profile to
+ */
+void myHeapProfileDump(const char *path)
+{
+#ifdef MALLOC_PROFILE
+	FILE *out = fopen(path, "w");
+	if (out == NULL)
+		return;
+
+	static bool folded[PROFILE_MAX_SAMPLES];
+
+	pthread_mutex_lock(&profileMutex);
+
+	size_t totalBytes = 0;
+	for (size_t i = 0; i < numProfileSamples; i++) {
+		totalBytes += profileSamples[i].size;
+		folded[i] = false;
+	}
+	fprintf(out, "heap profile: %zu: %zu [ %zu: %zu ] @ heap_v2/%d\n",
+			numProfileSamples, totalBytes, numProfileSamples, totalBytes,
+			PROFILE_INTERVAL);
+
+	for (size_t i = 0; i < numProfileSamples; i++) {
+		if (folded[i])
+			continue;
+
+		ProfileSample *sample = &profileSamples[i];
+		size_t count = 1;
+		size_t bytes = sample -> size;
+
+		for (size_t j = i + 1; j < numProfileSamples; j++) {
+			if (folded[j] || profileSamples[j].depth != sample -> depth ||
+					memcmp(profileSamples[j].stack, sample -> stack,
+						sample -> depth * sizeof(void *)) != 0)
+				continue;
+			folded[j] = true;
+			count++;
+			bytes += profileSamples[j].size;
+		}
+
+		fprintf(out, "%zu: %zu [ %zu: %zu ] @", count, bytes, count, bytes);
+		for (int k = 0; k < sample -> depth; k++)
+			fprintf(out, " %p", sample -> stack[k]);
+		fputc('\n', out);
+	}
+	pthread_mutex_unlock(&profileMutex);
+
+	fprintf(out, "\nMAPPED_LIBRARIES:\n");
+	FILE *maps = fopen("/proc/self/maps", "r");
+	if (maps != NULL) {
+		char buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), maps)) > 0)
+			fwrite(buf, 1, n, out);
+		fclose(maps);
+	}
+
+	fclose(out);
+#else
+	(void)path;
+#endif
+}
+
+/*
+ * Heap checkpointing: myHeapSnapshot serializes the warmed heap — the
+ * whole sbrk region plus the allocator's global state — and
+ * myHeapRestore reads it back into a fresh process of the same binary,
+ * so a startup heap built by thousands of allocations is recreated by
+ * one bulk read instead of replayed call by call.
+ *
+ * The image stores absolute addresses (freelist links, sentinels, chunk
+ * index), so a restore needs the identical address-space layout: the
+ * same binary with ASLR disabled, before its first allocation. The
+ * snapshot side must be quiesced: single threaded, with magazines and
+ * deferred frees consolidated, and no live mmap'd blocks (those pages
+ * are not part of the sbrk region and do not survive).
+ */
+#define HEAP_SNAPSHOT_MAGIC 0x70616568 // "heap"
+#define HEAP_SNAPSHOT_VERSION 1
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	// Layout-affecting build parameters; a snapshot restores only into a
+	// binary built with the same ones.
+	uint32_t numLists;
+	uint32_t numArenas;
+	uint32_t allocHeaderSize;
+	uint32_t unallocHeaderSize;
+	uint64_t globalBytes;
+	// The sbrk region the image covers: [start, end) at snapshot time.
+	void *start;
+	void *end;
+} HeapSnapshotHeader;
+
+/*
+ * Every piece of allocator state living outside the sbrk region. The
+ * chunk index arrays grown past MAX_NUM_CHUNKS live inside it and are
+ * carried by the region itself; the pointers to them are carried here.
+ */
+static const struct {
+	void *mem;
+	size_t size;
+} snapshotGlobals[] = {
+	{ arenas, sizeof(arenas) },
+	{ freelists, sizeof(freelists) },
+	{ freelistBitmap, sizeof(freelistBitmap) },
+#if MALLOC_ARENAS > 1
+	{ extraFreelists, sizeof(extraFreelists) },
+	{ extraFreelistBitmaps, sizeof(extraFreelistBitmaps) },
+	{ &nextArena, sizeof(nextArena) },
+	{ initialChunkArenas, sizeof(initialChunkArenas) },
+	{ &chunkArenas, sizeof(chunkArenas) },
+#endif
+	{ initialChunkList, sizeof(initialChunkList) },
+	{ &chunkList, sizeof(chunkList) },
+	{ &numChunks, sizeof(numChunks) },
+	{ &chunkCapacity, sizeof(chunkCapacity) },
+	{ &base, sizeof(base) },
+	{ &emergencyReserve, sizeof(emergencyReserve) },
+	{ &statChunks, sizeof(statChunks) },
+	{ &statMmaps, sizeof(statMmaps) },
+	{ &statHeapBytes, sizeof(statHeapBytes) },
+#ifdef MALLOC_VALIDATE
+	{ &heapEnd, sizeof(heapEnd) },
+#endif
+	{ &isMallocInitialized, sizeof(isMallocInitialized) },
+};
+
+#define NUM_SNAPSHOT_GLOBALS (sizeof(snapshotGlobals) / sizeof(snapshotGlobals[0]))
+
+/*
+ * @brief Write len bytes to fd, retrying partial writes.
+ *
+ * @param fd the file descriptor, mem the bytes, len the byte count
+ *
+ * @return True if every byte was written
+ */
+static bool _writeAll(int fd, const void *mem, size_t len)
+{
+	const char *bytes = mem;
+
+	while (len > 0) {
+		ssize_t written = write(fd, bytes, len);
+		if (written < 0)
+			return false;
+		bytes += written;
+		len -= written;
+	}
+	return true;
+}
+
+/*
+ * @brief Read exactly len bytes from fd.
+ *
+ * @param fd the file descriptor, mem the destination, len the byte count
+ *
+ * @return True if every byte was read
+ */
+static bool _readAll(int fd, void *mem, size_t len)
+{
+	char *bytes = mem;
+
+	while (len > 0) {
+		ssize_t got = read(fd, bytes, len);
+		if (got <= 0)
+			return false;
+		bytes += got;
+		len -= got;
+	}
+	return true;
+}
+
+/*
+ * @brief Serialize the heap and the allocator's state to a file.
+ *
+ * @param fd the descriptor to write the snapshot to
+ *
+ * @return True if the whole snapshot was written
+ */
+bool myHeapSnapshot(int fd)
+{
+	// init() never got a first chunk: nothing coherent to serialize.
+	if (base == NULL)
+		return false;
+
+	// Quiesce the allocator for a consistent image.
+	for (int a = 0; a < MALLOC_ARENAS; a++)
+		pthread_mutex_lock(&arenas[a].mutex);
+	pthread_mutex_lock(&chunkMutex);
+
+	HeapSnapshotHeader header = {
+		.magic = HEAP_SNAPSHOT_MAGIC,
+		.version = HEAP_SNAPSHOT_VERSION,
+		.numLists = NUM_LISTS,
+		.numArenas = MALLOC_ARENAS,
+		.allocHeaderSize = ALLOC_HEADER_SIZE,
+		.unallocHeaderSize = UNALLOC_HEADER_SIZE,
+		.end = sbrk(0),
+	};
+	for (size_t i = 0; i < NUM_SNAPSHOT_GLOBALS; i++)
+		header.globalBytes += snapshotGlobals[i].size;
+
+	// The image starts at the lowest sbrk address the allocator owns:
+	// the emergency reserve sits below the first chunk, and a donated
+	// reserve sits below base.
+	header.start = base;
+	if (emergencyReserve != NULL && emergencyReserve < header.start)
+		header.start = emergencyReserve;
+	if (numChunks > 0 && (void *)chunkList[0] < header.start)
+		header.start = chunkList[0];
+
+	bool ok = _writeAll(fd, &header, sizeof(header));
+	for (size_t i = 0; ok && i < NUM_SNAPSHOT_GLOBALS; i++)
+		ok = _writeAll(fd, snapshotGlobals[i].mem, snapshotGlobals[i].size);
+	if (ok)
+		ok = _writeAll(fd, header.start,
+				(char *)header.end - (char *)header.start);
+
+	pthread_mutex_unlock(&chunkMutex);
+	for (int a = 0; a < MALLOC_ARENAS; a++)
+		pthread_mutex_unlock(&arenas[a].mutex);
+
+	return ok;
+}
+
+/*
+ * @brief Restore a heap snapshot in a fresh process of the same binary.
+ *
+ * The break is extended over the recorded region and the image read
+ * back in one pass. The globals are staged in a scratch mapping first,
+ * so a failed or mismatched restore leaves the allocator pristine and
+ * the next allocation simply initializes a cold heap.
+ *
+ * @param fd the descriptor holding a snapshot, positioned at its start
+ *
+ * @return True if the heap was restored
+ */
+bool myHeapRestore(int fd)
+{
+	HeapSnapshotHeader header;
+	if (!_readAll(fd, &header, sizeof(header)) ||
+			header.magic != HEAP_SNAPSHOT_MAGIC ||
+			header.version != HEAP_SNAPSHOT_VERSION ||
+			header.numLists != NUM_LISTS ||
+			header.numArenas != MALLOC_ARENAS ||
+			header.allocHeaderSize != ALLOC_HEADER_SIZE ||
+			header.unallocHeaderSize != UNALLOC_HEADER_SIZE)
+		return false;
+
+	size_t globalBytes = 0;
+	for (size_t i = 0; i < NUM_SNAPSHOT_GLOBALS; i++)
+		globalBytes += snapshotGlobals[i].size;
+	if (header.globalBytes != globalBytes)
+		return false;
+
+	/*
+	 * init() has already run as a constructor, so this process owns a
+	 * cold heap that the image will overwrite. The image must start
+	 * exactly at this process's own lowest sbrk address — anything else
+	 * means the layout shifted (ASLR) and planting the image would
+	 * corrupt a break that is not where the snapshot expects it.
+	 */
+	if (header.start != (emergencyReserve != NULL ? emergencyReserve : base))
+		return false;
+
+	void *brk = sbrk(0);
+	if ((char *)header.end > (char *)brk &&
+			sbrk((char *)header.end - (char *)brk) == (void *)-1)
+		return false;
+
+	void *staged = mmap(NULL, globalBytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (staged == MAP_FAILED)
+		return false;
+
+	bool ok = _readAll(fd, staged, globalBytes) &&
+			_readAll(fd, header.start,
+					(char *)header.end - (char *)header.start);
+
+	if (ok) {
+		// Commit the staged globals only once the whole image is in.
+		char *src = (char *)staged;
+		for (size_t i = 0; i < NUM_SNAPSHOT_GLOBALS; i++) {
+			memcpy(snapshotGlobals[i].mem, src, snapshotGlobals[i].size);
+			src += snapshotGlobals[i].size;
+		}
+		// Locks are process state, not heap state: restore them pristine.
+		for (int a = 0; a < MALLOC_ARENAS; a++)
+			pthread_mutex_init(&arenas[a].mutex, NULL);
+	}
+
+	munmap(staged, globalBytes);
+	return ok;
+}
+
+/*
+ * @brief Coalesce all deferred frees across every arena.
+ *
+ * A no-op unless built with -DMALLOC_DEFERRED.
+ */
+void myMallocConsolidate()
+{
+#ifdef MALLOC_DEFERRED
+	for (int a = 0; a < MALLOC_ARENAS; a++) {
+		Arena *arena = &arenas[a];
+
+		pthread_mutex_lock(&arena -> mutex);
+		_consolidateArena(arena);
+		pthread_mutex_unlock(&arena -> mutex);
+	}
+#endif
+}
+
+#ifdef MALLOC_MAGAZINES
+/*
+ * @brief Spill half of an overflowing magazine to the locked freelists.
+ *
+ * @param index the size class whose magazine overflowed
+ */
+static void _spillMagazine(int index)
+{
+	for (int i = 0; i < MAGAZINE_SIZE / 2; i++) {
+		Header *hdr = magazines[index];
+		magazines[index] = *(Header **)hdr -> data;
+		magazineCounts[index]--;
+		_freeToArena(hdr -> data);
+	}
+}
+#endif
+
+void myFree(void *ptr)
+{
+#ifdef MALLOC_VALIDATE
+	// Vet the pointer before any header byte is read: a wild free is
+	// logged and dropped instead of faulting or corrupting the freelists.
+	if (ptr != NULL && !_validPointer(ptr)) {
+		fprintf(stderr, "myFree: invalid or already-freed pointer %p\n", ptr);
+		return;
+	}
+#endif
+
+#ifdef MALLOC_MAGAZINES
+	// Push onto the thread-local magazine with no locking.
+	if (ptr != NULL) {
+		Header *hdr = ptrToHeader(ptr);
+		int index = _getFreelistIndex(getSize(hdr));
+#ifdef MALLOC_SIZECLASSES
+		// Geometric classes hold ranges, so only linear classes cache.
+		if (index < NUM_LINEAR_LISTS && getState(hdr) == ALLOCATED) {
+#else
+		if (index < NUM_LISTS - 1 && getState(hdr) == ALLOCATED) {
+#endif
+#ifdef MALLOC_HARDEN
+			// The block skips deallocObject until the magazine spills,
+			// so check it here while the free is still attributable to
+			// the caller.
+			_verifyHardened(hdr);
+#endif
+			setRecycled(hdr, true);
+			if (magazineCounts[index] == MAGAZINE_SIZE)
+				_spillMagazine(index);
+			*(Header **)hdr -> data = magazines[index];
+			magazines[index] = hdr;
+			magazineCounts[index]++;
+			return;
+		}
+	}
+#endif
+
+	_freeToArena(ptr);
+}
+
+bool verify()
+{
+	return verifyFreelist() && verifyTags();
+}
+
+/*
+ * @brief Verify only the headers touched since the last check.
+ *
+ * O(changes) instead of O(heap); falls back to the full verify scan when
+ * the dirty set overflowed. Without -DMALLOC_INCREMENTAL nothing is
+ * recorded and every call is the full scan.
+ *
+ * @return true if no touched header violates its invariants
+ */
+bool verifyIncremental()
+{
+#ifdef MALLOC_INCREMENTAL
+	pthread_mutex_lock(&dirtyMutex);
+
+	if (dirtyOverflow) {
+		dirtyOverflow = false;
+		numDirty = 0;
+		pthread_mutex_unlock(&dirtyMutex);
+		return verify();
+	}
+
+	for (size_t i = 0; i < numDirty; i++) {
+		Header *hdr = dirtySet[i].hdr;
+
+		// A header whose bytes moved on since the snapshot was taken has
+		// been re-marked by whatever changed it (or absorbed entirely).
+		if (hdr -> size != dirtySet[i].size || hdr -> leftSize != dirtySet[i].leftSize)
+			continue;
+
+		if (getSize(hdr) != getRightHeader(hdr) -> leftSize) {
+			fprintf(stderr, "Invalid sizes\n");
+			print_object(hdr);
+			pthread_mutex_unlock(&dirtyMutex);
+			return false;
+		}
+
+		if (getState(hdr) == UNALLOCATED &&
+				(getPrev(getNext(hdr)) != hdr || getNext(getPrev(hdr)) != hdr)) {
+			fprintf(stderr, "Invalid pointers\n");
+			print_object(hdr);
+			pthread_mutex_unlock(&dirtyMutex);
+			return false;
+		}
+	}
+
+	numDirty = 0;
+	pthread_mutex_unlock(&dirtyMutex);
+	return true;
+#else
+	return verify();
+#endif
+}
+
+#ifdef MALLOC_TRACE
+#undef myMalloc
+#undef myCalloc
+#undef myRealloc
+#undef myFree
+
+// Traced wrappers: record one TraceRecord per logical call and forward
+// to the untraced internals defined above.
+void *myMalloc(size_t size)
+{
+	void *mem = _myMallocUntraced(size);
+
+	_traceRecord(TRACE_MALLOC, size, NULL, mem);
+	return mem;
+}
+
+void *myCalloc(size_t nmemb, size_t size)
+{
+	void *mem = _myCallocUntraced(nmemb, size);
+
+	_traceRecord(TRACE_CALLOC, nmemb * size, NULL, mem);
+	return mem;
+}
+
+void *myRealloc(void *ptr, size_t size)
+{
+	void *mem = _myReallocUntraced(ptr, size);
+
+	_traceRecord(TRACE_REALLOC, size, ptr, mem);
+	return mem;
+}
+
+void myFree(void *ptr)
+{
+	_traceRecord(TRACE_FREE, 0, ptr, NULL);
+	_myFreeUntraced(ptr);
+}
+#endif
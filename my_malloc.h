@@ -2,6 +2,7 @@
 #define __MY_MALLOC_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 #define RELATIVE_POINTERS true
@@ -11,17 +12,94 @@
 #define ARENA_SIZE 4096
 #endif
 
+#ifdef MALLOC_SIZECLASSES
+/*
+ * Building with -DMALLOC_SIZECLASSES adds geometric size classes above
+ * the linear range: four classes per doubling (quarter steps), with
+ * boundaries 512, 640, 768, 896, 1024, 1280, ... Multi-KB allocations
+ * then get the same near-O(1) class lookup as small ones instead of
+ * colliding into the overflow list's linear scan, and internal
+ * fragmentation per class stays below 25%. Sizes past the last
+ * geometric class still fall through to the overflow list.
+ */
+#define NUM_LINEAR_LISTS 58
+#define NUM_GEOMETRIC_LISTS 48
+#define NUM_LISTS (NUM_LINEAR_LISTS + NUM_GEOMETRIC_LISTS + 1)
+#endif
+
 #ifndef NUM_LISTS
 // If not specified at compile time use the default number of free lists
 #define NUM_LISTS 59
 #endif
 
+#ifdef MALLOC_FOOTERS
+/*
+ * Building with -DMALLOC_FOOTERS moves the leftSize boundary tag of free
+ * blocks into a footer at the block's end, so allocated blocks need only
+ * the 8-byte size word and their old leftSize word becomes user data.
+ * Metadata overhead on a 24-byte object drops from 16 of 40 bytes to 8 of
+ * 32. The third bit of the size word flags whether the left neighbor is
+ * free (and its footer valid); coalescing reaches the left header through
+ * the footer instead of leftSize. The flag therefore displaces the
+ * recycled bit (myCalloc always zeroes) and cannot combine with layouts
+ * or checks built on the leftSize field.
+ */
+#if defined(MALLOC_COMPACT) || defined(MALLOC_HARDEN) || defined(MALLOC_INCREMENTAL)
+#error "MALLOC_FOOTERS is incompatible with MALLOC_COMPACT, MALLOC_HARDEN, and MALLOC_INCREMENTAL"
+#endif
+#endif
+
+#ifndef CHUNK_GROWTH_FACTOR
+/*
+ * If not specified at compile time chunks are requested from the OS at a
+ * fixed ARENA_SIZE. Building with -DCHUNK_GROWTH_FACTOR=N (N > 1) grows
+ * each successive OS request geometrically, starting at ARENA_SIZE and
+ * capped at CHUNK_GROWTH_CAP, so the syscall count scales logarithmically
+ * with the heap footprint instead of linearly.
+ */
+#define CHUNK_GROWTH_FACTOR 1
+#endif
+
+#ifndef CHUNK_GROWTH_CAP
+// Largest chunk geometric growth will request from the OS
+#define CHUNK_GROWTH_CAP (1024 * (size_t)ARENA_SIZE)
+#endif
+
+#ifdef MALLOC_SHARDS
+/*
+ * Building with -DMALLOC_SHARDS=N shards the allocator by size class
+ * instead of by thread: the freelists are split into N contiguous groups,
+ * each backed by its own arena and mutex, so threads working in disjoint
+ * size classes proceed in parallel without per-thread arenas. Frees of
+ * blocks owned by another shard go through that shard's remote-free
+ * stack, so the free fast path stays lock-free. Chunk allocation remains
+ * serialized by the chunk mutex. Split remainders that fall below a
+ * shard's own classes are reused only after coalescing grows them back.
+ */
+#define MALLOC_ARENAS MALLOC_SHARDS
+#endif
+
+#ifndef MALLOC_ARENAS
+// If not specified at compile time use a single arena (one freelist array
+// and one mutex shared by every thread). Building with -DMALLOC_ARENAS=N
+// creates N arenas, each with its own freelists, mutex, and lastFencepost.
+// Threads are assigned to arenas round-robin on their first allocation so
+// independent threads never contend on the fast path.
+#define MALLOC_ARENAS 1
+#endif
+
 /*
  * Size of the header for an allocated block = 16
  * The size of the normal minus the size of the two free list pointers as
  * they are only maintained while block is free
  */
+#ifdef MALLOC_FOOTERS
+#define ALLOC_HEADER_SIZE sizeof(size_t)
+#elif defined(MALLOC_COMPACT)
+#define ALLOC_HEADER_SIZE (2 * sizeof(size_t))
+#else
 #define ALLOC_HEADER_SIZE (sizeof(Header) - (2 * sizeof(Header *)))
+#endif
 
 /* The minimum size request the allocator will service */
 #define MIN_ALLOCATION 8
@@ -32,6 +110,30 @@
 /* Size of the header for an unallocated block = 32 */
 #define UNALLOC_HEADER_SIZE sizeof(Header)
 
+#ifdef MALLOC_HARDEN
+/* Bytes reserved at the end of every block for the trailing canary */
+#define CANARY_SIZE 32
+#endif
+
+#ifdef MALLOC_FOOTERS
+/* Size of the boundary-tag footer at the end of a free block */
+#define FOOTER_SIZE sizeof(size_t)
+/* The smallest block must hold the free header plus its footer */
+#define MIN_BLOCK_SIZE (UNALLOC_HEADER_SIZE + FOOTER_SIZE)
+#else
+/* The smallest block is exactly the unallocated header */
+#define MIN_BLOCK_SIZE UNALLOC_HEADER_SIZE
+#endif
+
+#ifndef MMAP_THRESHOLD
+/*
+ * Allocations whose total size exceeds what a single chunk can hold are
+ * serviced directly by mmap instead of the freelists and handed back to
+ * the OS with munmap when freed.
+ */
+#define MMAP_THRESHOLD (ARENA_SIZE - 2 * ALLOC_HEADER_SIZE)
+#endif
+
 /**
  * @brief enum representing the allocation state of a block
  *
@@ -42,6 +144,8 @@ typedef enum {
 	UNALLOCATED = 0,
   	ALLOCATED = 1,
   	FENCEPOST = 2,
+  	// Block allocated directly with mmap, tracked outside the freelists
+  	MMAPPED = 3,
 } State;
 
 /*
@@ -61,7 +165,10 @@ typedef enum {
  *
  * FIELDS ALWAYS PRESENT
  * size_t size: The size of the current block *including metadata*
- * size_t left_size: The size of the block to the left (in memory)
+ * size_t left_size: The size of the block to the left (in memory); absent
+ * with MALLOC_FOOTERS, where a free block records its size in a footer at
+ * its end instead
+
  *
  * FIELDS PRESENT WHEN FREE
  * Header *next: The next block in the free list (only valid if free)
@@ -74,7 +181,28 @@ typedef enum {
  */
 typedef struct _Header {
 	size_t size;
+#ifndef MALLOC_FOOTERS
   	size_t leftSize;
+#endif
+#ifdef MALLOC_COMPACT
+	/*
+	 * Building with -DMALLOC_COMPACT stores the free list links as 32-bit
+	 * offsets from base instead of full pointers, shrinking the free
+	 * header from 32 to 24 bytes and with it the minimum block size and
+	 * the split threshold. All link access goes through the
+	 * getNext/setNext/getPrev/setPrev helpers below, which assume the
+	 * heap and the freelist sentinels both lie within 2GiB of base.
+	 */
+  	union {
+    	// Used when the object is free
+    	struct {
+      		int32_t nextOff;
+      		int32_t prevOff;
+    	};
+    	// Used when the object is allocated
+    	char data[0];
+	};
+#else
   	union {
     	// Used when the object is free
     	struct {
@@ -84,21 +212,24 @@ typedef struct _Header {
     	// Used when the object is allocated
     	char data[0];
 	};
+#endif
 } Header;
 
 // Helper functions for getting and storing size and state from Header
 // Since the size is a multiple of 8, the last 3 bits are always 0s. -> ??
 // Therefore we use the 3 lowest bits to store the state of the object.
 // This is going to save 8 bytes in all objects.
+// The two lowest bits hold the State and the third bit records whether
+// the block's memory has ever been recycled (written and freed).
 
 static inline size_t getSize(Header *hdr)
 {
-	return hdr -> size & ~0x3;
+	return hdr -> size & ~0x7;
 }
 
 static inline void setSize(Header *hdr, size_t size)
 {
-	hdr -> size = size | (hdr -> size & 0x3);
+	hdr -> size = size | (hdr -> size & 0x7);
 }
 
 static inline State getState(Header *hdr)
@@ -113,19 +244,285 @@ static inline void setState(Header *hdr, State state)
 
 static inline void setSizeAndState(Header *hdr, size_t size, State state)
 {
-	hdr -> size = (size & ~0x3) | (state & 0x3);
+	hdr -> size = (size & ~0x7) | (state & 0x3);
+}
+
+// Blocks carved from fresh OS memory keep the recycled bit clear, which
+// lets myCalloc skip zeroing memory the OS already zeroed. Only the free
+// list pointers at the start of a virgin block's data area may be dirty.
+// MALLOC_FOOTERS repurposes the bit as the left-free flag, so there every
+// block reports as recycled and myCalloc always zeroes.
+
+static inline bool getRecycled(Header *hdr)
+{
+#ifdef MALLOC_FOOTERS
+	(void)hdr;
+	return true;
+#else
+	return hdr -> size & 0x4;
+#endif
+}
+
+static inline void setRecycled(Header *hdr, bool recycled)
+{
+#ifdef MALLOC_FOOTERS
+	(void)hdr;
+	(void)recycled;
+#else
+	hdr -> size = recycled ? (hdr -> size | 0x4) : (hdr -> size & ~0x4);
+#endif
+}
+
+#ifdef MALLOC_FOOTERS
+// The third bit of the size word records whether the block's left
+// neighbor is free, i.e. whether the footer just below this header holds
+// that neighbor's size. Allocated left neighbors lend the footer word to
+// their user data, which is what shrinks the allocated header to 8 bytes.
+
+static inline bool getLeftFree(Header *hdr)
+{
+	return hdr -> size & 0x4;
+}
+
+static inline void setLeftFree(Header *hdr, bool leftFree)
+{
+	hdr -> size = leftFree ? (hdr -> size | 0x4) : (hdr -> size & ~0x4);
+}
+#endif
+
+// The size arithmetic lives in the header so that calls with a
+// compile-time constant size (myMallocFixed below) constant-fold it away
+// entirely; my_malloc.c uses the same definitions.
+
+/*
+ * @brief Compute the actual size of memory allocation from the raw size.
+ *
+ * @param rawSize Request size of a user
+ *
+ * @return An actual size to be allocated
+ */
+static inline size_t _calcActualSize(size_t rawSize)
+{
+	// Round up the raw size to be a multiple of 8-byte.
+	rawSize = rawSize % MULTIPLE_8 == 0 ? rawSize : (((rawSize / MULTIPLE_8) + 1) * MULTIPLE_8);
+	// Actual size = rounded request size + allocated metadata
+	size_t actualSize = ALLOC_HEADER_SIZE + rawSize;
+	// Minimum allocation size = smallest block a free header (and, with
+	// MALLOC_FOOTERS, its footer) fits in
+	actualSize = actualSize > MIN_BLOCK_SIZE ? actualSize : MIN_BLOCK_SIZE;
+
+#ifdef MALLOC_HARDEN
+	// Room for the trailing canary; stays a multiple of 8.
+	actualSize += CANARY_SIZE;
+#endif
+
+	return actualSize;
+}
+
+/*
+ * @brief Compute an index of a freelist to get a block for allocation based on the actual size.
+ *
+ * @param actualSize The actual size of memory allocation.
+ *
+ * @return An index of an appropriate freelist
+ */
+#ifdef MALLOC_SIZECLASSES
+// First geometric class boundary (block size including metadata)
+#define GEOM_BASE_SIZE 512
+#define GEOM_BASE_LOG 9
+
+/*
+ * @brief Map a block size past the linear classes to its geometric class.
+ *
+ * Classes are quarter steps between powers of two; a class holds every
+ * size above the previous boundary up to its own, so the mapping is a
+ * couple of shifts rather than a scan.
+ *
+ * @param actualSize a block size past the linear range
+ *
+ * @return An index into the geometric classes, NUM_GEOMETRIC_LISTS when
+ * the size is past the last class
+ */
+static inline int _getGeometricIndex(size_t actualSize)
+{
+	if (actualSize <= GEOM_BASE_SIZE)
+		return 0;
+
+	int log = 63 - __builtin_clzll(actualSize - 1);
+	size_t step = (size_t)1 << (log - 2);
+	int index = (log - GEOM_BASE_LOG) * 4 +
+			(int)((actualSize - ((size_t)1 << log) - 1) / step) + 1;
+
+	return index < NUM_GEOMETRIC_LISTS ? index : NUM_GEOMETRIC_LISTS;
+}
+#endif
+
+static inline int _getFreelistIndex(size_t actualSize)
+{
+	// A block in a freelist excludes metadata.
+	int index = ((actualSize - ALLOC_HEADER_SIZE) / MULTIPLE_8) - 1;
+#ifdef MALLOC_SIZECLASSES
+	if (index >= NUM_LINEAR_LISTS)
+		index = NUM_LINEAR_LISTS + _getGeometricIndex(actualSize);
+	return index;
+#else
+	// Index must be smaller than the NUM_LISTS.
+	return index < NUM_LISTS ? index : NUM_LISTS - 1;
+#endif
 }
 
+#ifndef CACHE_LINE_SIZE
+// Cache line size assumed by the padded layout below
+#define CACHE_LINE_SIZE 64
+#endif
+
+/*
+ * Storage for one freelist sentinel. The default build packs the 32-byte
+ * sentinels two per cache line; building with -DMALLOC_PADDED pads each
+ * one to its own aligned line so sharded or multi-arena builds pushing
+ * to adjacent size classes stop false-sharing sentinel lines.
+ */
+#ifdef MALLOC_PADDED
+typedef union {
+	Header sentinel;
+	char pad[CACHE_LINE_SIZE];
+} __attribute__((aligned(CACHE_LINE_SIZE))) FreeList;
+#else
+typedef union {
+	Header sentinel;
+} FreeList;
+#endif
+
 #define MAX_NUM_CHUNKS 1024
 
+/*
+ * Binary trace record written by builds with -DMALLOC_TRACE and replayed
+ * by bench/trace_replay. Each myMalloc/myCalloc/myRealloc/myFree call
+ * appends one record to a per-thread buffer that is flushed to the file
+ * named by the MALLOC_TRACE_FILE environment variable (default
+ * my_malloc.trace). Pointers identify blocks across record and replay;
+ * the replayer maps them to the pointers of its own run.
+ */
+typedef enum {
+	TRACE_MALLOC = 1,
+	TRACE_CALLOC = 2,
+	TRACE_REALLOC = 3,
+	TRACE_FREE = 4,
+} TraceOp;
+
+typedef struct {
+	// One of TraceOp
+	uint16_t op;
+	// Id of the calling thread, assigned in order of first allocation
+	uint16_t tid;
+	uint32_t unused;
+	// Requested size in bytes (nmemb * size for calloc, 0 for free)
+	uint64_t size;
+	// Pointer argument (free and realloc)
+	uint64_t ptr;
+	// Returned pointer (malloc, calloc, and realloc)
+	uint64_t result;
+} TraceRecord;
+
+/*
+ * Runtime counters kept per arena and aggregated by myMallocStats. The
+ * hot paths pay a plain increment under the arena mutex they already
+ * hold; aggregation only happens when queried. Operations absorbed by
+ * thread-local caches (magazines, deferred frees) are counted when the
+ * blocks reach the arena freelists.
+ */
+typedef struct {
+	// Allocations served from the freelists
+	size_t mallocs;
+	// Blocks released back to the freelists
+	size_t frees;
+	// Allocations that split a larger block
+	size_t splits;
+	// Neighbor merges performed while freeing
+	size_t coalesces;
+	// Chunks requested from the OS with sbrk
+	size_t chunks;
+	// Large allocations served directly by mmap
+	size_t mmaps;
+	// Blocks examined while searching the overflow freelist
+	size_t searchSteps;
+} MallocStats;
+
+/*
+ * Heap occupancy and fragmentation metrics reported by myMallocHeapInfo.
+ * All figures count whole blocks, headers included; mmap'd blocks live
+ * outside the heap and are not reported.
+ */
+typedef struct {
+	// Total bytes obtained from the OS with sbrk for chunks
+	size_t heapBytes;
+	// Bytes held by allocated blocks (and fencepost overhead)
+	size_t allocatedBytes;
+	// Bytes sitting on the freelists
+	size_t freeBytes;
+	// Free bytes broken down by freelist class
+	size_t freeBytesByClass[NUM_LISTS];
+	// Size of the largest free block
+	size_t largestFreeBlock;
+	// Chunks requested from the OS
+	size_t chunks;
+} HeapInfo;
+
 // Malloc interface
 void *myMalloc(size_t size);
 void *myCalloc(size_t nmemb, size_t size);
 void *myRealloc(void *ptr, size_t size);
+void *myMemalign(size_t alignment, size_t size);
 void myFree(void *ptr);
+// Number of usable bytes in the block backing ptr, which may exceed the
+// size requested when the allocator declined to split the slack off
+size_t myMallocUsableSize(void *ptr);
+// Batched variants that take the arena lock once for a whole burst
+size_t myMallocBatch(size_t size, size_t n, void **out);
+void myFreeBatch(void **ptrs, size_t n);
+// Allocate a block whose pages are bound to one NUMA node, for
+// partitioned data structures; without -DMALLOC_NUMA the node is
+// ignored and the request falls through to myMalloc
+void *myMallocOnNode(size_t size, int node);
+
+/*
+ * Region/scratch allocator for allocations that are all reclaimed
+ * together. myRegionAlloc is an unlocked, headerless bump pointer into
+ * chunks dedicated to the region, and myRegionReset reclaims everything
+ * in O(1) while retaining the chunks for reuse. A region must not be
+ * shared between threads without external synchronization.
+ */
+typedef struct _Region Region;
+Region *myRegionCreate();
+void *myRegionAlloc(Region *region, size_t size);
+void myRegionReset(Region *region);
+void myRegionDestroy(Region *region);
+// Coalesce deferred frees in one batch (no-op unless built with
+// -DMALLOC_DEFERRED, which makes myFree defer coalescing entirely)
+void myMallocConsolidate();
+// Aggregate the runtime counters of every arena into *out
+void myMallocStats(MallocStats *out);
+// Report heap occupancy and fragmentation metrics into *out
+void myMallocHeapInfo(HeapInfo *out);
+// Write the samples collected by a -DMALLOC_PROFILE build as a pprof
+// heap profile; a no-op in builds without the flag
+void myHeapProfileDump(const char *path);
+/*
+ * Heap checkpointing: serialize the warmed heap (the sbrk region plus
+ * the allocator's global state) to a file, and read it back in a fresh
+ * process of the same binary before its first allocation. The image
+ * holds absolute addresses, so restoring needs an identical layout:
+ * same build, ASLR disabled. Snapshot from a quiesced process with no
+ * live mmap'd blocks; a failed restore leaves the allocator cold.
+ */
+bool myHeapSnapshot(int fd);
+bool myHeapRestore(int fd);
 
 // Debug list verifitcation
 bool verify();
+// O(changes) verification of headers touched since the last check when
+// built with -DMALLOC_INCREMENTAL; otherwise the full scan
+bool verifyIncremental();
 
 // Helper to find a block's right neighbor
 Header *getRightHeader(Header *hdr);
@@ -137,9 +534,95 @@ Header *getRightHeader(Header *hdr);
  * will be present when the final binary is linked
  */
 extern void *base;
-extern Header freelists[];
+extern FreeList freelists[];
 extern char freelistBitmap[];
-extern Header *chunkList[];
+extern Header **chunkList;
 extern size_t numChunks;
 
+// Free list link accessors. The default build reads and writes the
+// pointer fields directly; MALLOC_COMPACT builds translate to and from
+// 32-bit offsets relative to base.
+
+static inline Header *getNext(Header *hdr)
+{
+#ifdef MALLOC_COMPACT
+	return (Header *)((char *)base + hdr -> nextOff);
+#else
+	return hdr -> next;
+#endif
+}
+
+static inline void setNext(Header *hdr, Header *next)
+{
+#ifdef MALLOC_COMPACT
+	hdr -> nextOff = (int32_t)((char *)next - (char *)base);
+#else
+	hdr -> next = next;
+#endif
+}
+
+static inline Header *getPrev(Header *hdr)
+{
+#ifdef MALLOC_COMPACT
+	return (Header *)((char *)base + hdr -> prevOff);
+#else
+	return hdr -> prev;
+#endif
+}
+
+static inline void setPrev(Header *hdr, Header *prev)
+{
+#ifdef MALLOC_COMPACT
+	hdr -> prevOff = (int32_t)((char *)prev - (char *)base);
+#else
+	hdr -> prev = prev;
+#endif
+}
+
+#ifdef MALLOC_MAGAZINES
+// Thread-local per-size-class caches of freed blocks, defined in
+// my_malloc.c and exposed here for the myMallocFixed fast path.
+extern __thread Header *magazines[];
+extern __thread int magazineCounts[];
+#endif
+
+/*
+ * @brief Allocate size bytes, specialized for compile-time constant sizes.
+ *
+ * The size arithmetic above is pure and folds away when size is a
+ * constant (fixed-size container nodes, for example), so the checks below
+ * compile to nothing and, with MALLOC_MAGAZINES, the whole call inlines
+ * to a pop from the thread's magazine for the precomputed size class.
+ * Without magazines the freelists are only reachable under their arena
+ * mutex, so the call falls through to myMalloc with the arithmetic
+ * already done. Behaves exactly like myMalloc for any size.
+ *
+ * @param size Number of bytes to allocate
+ *
+ * @return A pointer to the allocated memory, as from myMalloc
+ */
+static inline void *myMallocFixed(size_t size)
+{
+#if defined(MALLOC_MAGAZINES) && !defined(MALLOC_TRACE) && !defined(MALLOC_PROFILE)
+	// Traced and profiled builds route through myMalloc so the inlined
+	// pop cannot dodge their records and samples.
+	if (size != 0 && _calcActualSize(size) <= MMAP_THRESHOLD) {
+		int index = _getFreelistIndex(_calcActualSize(size));
+#ifdef MALLOC_SIZECLASSES
+		// Geometric classes hold ranges, so only linear classes cache.
+		if (index < NUM_LINEAR_LISTS && magazines[index] != NULL) {
+#else
+		if (index < NUM_LISTS - 1 && magazines[index] != NULL) {
+#endif
+			Header *hdr = magazines[index];
+			magazines[index] = *(Header **)hdr -> data;
+			magazineCounts[index]--;
+			return hdr -> data;
+		}
+	}
+#endif
+
+	return myMalloc(size);
+}
+
 #endif // __MY_MALLOC_H__
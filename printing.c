@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "my_malloc.h"
 #include "printing.h"
@@ -91,7 +92,7 @@ static void clear_color() {
 
 static inline bool is_sentinel(void * p) {
   for (int i = 0; i < NUM_LISTS; i++) {
-    if (&freelists[i] == p) {
+    if (&freelists[i].sentinel == p) {
       return true;
     }
   }
@@ -131,15 +132,22 @@ void print_object(Header * block) {
   print_pointer(block);
   puts("");
   printf("\tsize: %zd\n", getSize(block) );
+#ifdef MALLOC_FOOTERS
+  // An allocated left neighbor lends its boundary word to user data, so
+  // only a free one leaves a readable footer below this header.
+  printf("\tleft_size: %zd\n",
+         getLeftFree(block) ? *((size_t *)block - 1) : (size_t)0);
+#else
   printf("\tleft_size: %zd\n", block->leftSize);
+#endif
   printf("\tallocated: %s\n", allocated_to_string(getState(block)));
   if (!getState(block)) {
     printf("\tprev: ");
-    print_pointer(block->prev);
+    print_pointer(getPrev(block));
     puts("");
 
     printf("\tnext: ");
-    print_pointer(block->next);
+    print_pointer(getNext(block));
     puts("");
   }
   printf("]\n");
@@ -193,7 +201,7 @@ static void print_bitmap() {
  * @param end Node to stop printing at
  */
 void print_sublist(printFormatter pf, Header * start, Header * end) {  
-  for (Header * cur = start; cur != end; cur = cur->next) {
+  for (Header * cur = start; cur != end; cur = getNext(cur)) {
     pf(cur); 
   }
 }
@@ -209,10 +217,10 @@ void freelist_print(printFormatter pf) {
   }
 
   for (size_t i = 0; i < NUM_LISTS; i++) {
-    Header * freelist = &freelists[i];
-    if (freelist->next != freelist) {
+    Header * freelist = &freelists[i].sentinel;
+    if (getNext(freelist) != freelist) {
       printf("L%zu: ", i);
-      print_sublist(pf, freelist->next, freelist);
+      print_sublist(pf, getNext(freelist), freelist);
       puts("");
     }
     fflush(stdout);
@@ -233,7 +241,7 @@ void tags_print(printFormatter pf) {
     Header * chunk = chunkList[i];
     pf(chunk);
     for (chunk = getRightHeader(chunk);
-         getState(chunk) != FENCEPOST; 
+         getState(chunk) != FENCEPOST;
          chunk = getRightHeader(chunk)) {
         pf(chunk);
     }
@@ -241,3 +249,76 @@ void tags_print(printFormatter pf) {
     fflush(stdout);
   }
 }
+
+// Records buffered per snapshot_flush; 256 keeps the stack frame small
+// enough for a signal handler's alternate stack.
+#define SNAPSHOT_BATCH 256
+
+/**
+ * @brief Write a full buffer of records, retrying partial writes
+ *
+ * @param fd The file descriptor to write to
+ * @param buf The records to write
+ * @param n The number of records in buf
+ *
+ * @return true if every byte was written
+ */
+static bool snapshot_flush(int fd, SnapshotRecord * buf, size_t n) {
+  const char * bytes = (const char *) buf;
+  size_t remaining = n * sizeof(SnapshotRecord);
+
+  while (remaining > 0) {
+    ssize_t written = write(fd, bytes, remaining);
+    if (written < 0) {
+      return false;
+    }
+    bytes += written;
+    remaining -= written;
+  }
+  return true;
+}
+
+/**
+ * @brief Dump every boundary tag as a packed binary record
+ *
+ * One chunk walk streamed through write(2): no printf, no allocation,
+ * so it is cheap enough to call from a signal handler on a large heap.
+ * The caller owns fd and any locking; a dump of a running process is a
+ * best-effort picture of a moving heap.
+ *
+ * @param fd The file descriptor to stream the snapshot to
+ *
+ * @return true if the whole snapshot was written
+ */
+bool tags_snapshot(int fd) {
+  uint32_t header[2] = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION };
+  if (write(fd, header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+
+  SnapshotRecord buf[SNAPSHOT_BATCH];
+  size_t n = 0;
+
+  for (size_t i = 0; i < numChunks; i++) {
+    Header * chunk = chunkList[i];
+    for (bool last = false; !last; chunk = getRightHeader(chunk)) {
+      // The walk starts on a fencepost, so stop on the second one
+      last = chunk != chunkList[i] && getState(chunk) == FENCEPOST;
+
+      buf[n++] = (SnapshotRecord) {
+        .offset = (uint64_t) ((char *) chunk - (char *) base),
+        .size = getSize(chunk),
+        .state = getState(chunk),
+        .chunk = (uint32_t) i,
+      };
+      if (n == SNAPSHOT_BATCH) {
+        if (!snapshot_flush(fd, buf, n)) {
+          return false;
+        }
+        n = 0;
+      }
+    }
+  }
+
+  return snapshot_flush(fd, buf, n);
+}
@@ -27,4 +27,21 @@ void tags_print(printFormatter pf);
 void print_sublist(printFormatter pf, Header * start, Header * end);
 void print_pointer(void * p);
 
+/* Binary heap snapshot: one packed record per boundary tag, streamed
+ * through buffered write(2) calls so dumping a large heap is I/O-bound
+ * instead of printf-bound. utils/snapshotPrint.py renders the usual
+ * text format from a snapshot file offline.
+ */
+#define SNAPSHOT_MAGIC 0x70616e73 // "snap"
+#define SNAPSHOT_VERSION 1
+
+typedef struct {
+  uint64_t offset; // bytes from the heap base (print_pointer's offsets)
+  uint64_t size;
+  uint32_t state;
+  uint32_t chunk;  // index of the chunk the block belongs to
+} SnapshotRecord;
+
+bool tags_snapshot(int fd);
+
 #endif // PRINTING_H
@@ -1,10 +1,84 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include "my_malloc.h"
 #include "testing.h"
 
+#define MALLOC_QUIET "MALLOC_TEST_QUIET"
+
+static bool quiet_checked;
+static bool quiet;
+
+static const char * test_name = "";
+// FNV-1a offset basis; every operation and heap state folds into this.
+static uint64_t digest = 14695981039346656037ull;
+
+/**
+ * @brief Check once whether the quiet digest mode is enabled
+ *
+ * @return true if MALLOC_TEST_QUIET is set to 1 in the environment
+ */
+bool test_quiet() {
+  if (!quiet_checked) {
+    const char * var = getenv(MALLOC_QUIET);
+    quiet = var != NULL && !strcmp(var, "1");
+    quiet_checked = true;
+  }
+  return quiet;
+}
+
+/**
+ * @brief Fold one value into the running FNV-1a digest
+ *
+ * @param value The value to fold, one byte at a time
+ */
+static void digest_fold(uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    digest ^= (value >> (8 * i)) & 0xff;
+    digest *= 1099511628211ull;
+  }
+}
+
+/**
+ * @brief Fold one block's coordinates into the digest
+ *
+ * @param block The block to fold
+ */
+static void digest_header(Header * block) {
+  digest_fold((uint64_t)((void *)block - base));
+  digest_fold(getSize(block));
+  digest_fold(getState(block));
+}
+
+/**
+ * @brief Fold the freelists and boundary tags into the digest
+ *
+ * Walks the same structures freelist_print and tags_print walk, so the
+ * digest changes whenever the printed text would have.
+ */
+static void digest_state() {
+  for (size_t i = 0; i < NUM_LISTS; i++) {
+    Header * freelist = &freelists[i].sentinel;
+    for (Header * cur = getNext(freelist); cur != freelist; cur = getNext(cur)) {
+      digest_fold(i);
+      digest_header(cur);
+    }
+  }
+
+  for (size_t i = 0; i < numChunks; i++) {
+    Header * chunk = chunkList[i];
+    digest_header(chunk);
+    for (chunk = getRightHeader(chunk);
+         getState(chunk) != FENCEPOST;
+         chunk = getRightHeader(chunk)) {
+      digest_header(chunk);
+    }
+    digest_header(chunk);
+  }
+}
+
 /**
  * @brief Print the name of the test file and the initial state of 
  *        the data structures
@@ -13,7 +87,14 @@
  */
 void initialize_test(const char * name) {
   const char * filename = strrchr(name, '/');
-  printf("TEST: %s\n", filename ? filename+1 : name);
+  test_name = filename ? filename+1 : name;
+
+  if (test_quiet()) {
+    digest_state();
+    return;
+  }
+
+  printf("TEST: %s\n", test_name);
 
   printf("INTIAL STATE\n\n");
   printf("FREELIST\n");
@@ -27,6 +108,14 @@ void initialize_test(const char * name) {
  *        validity
  */
 void finalize_test() {
+  if (test_quiet()) {
+    digest_state();
+    verify();
+    printf("TEST: %s DIGEST: %016llx\n", test_name,
+           (unsigned long long) digest);
+    return;
+  }
+
   printf("FINAL STATE\n\n");
 
   printf("FREELIST\n");
@@ -65,7 +154,7 @@ static void * malloc_and_clear(size_t size) {
  * @return The array of pointers to allocated memory
  */
 void ** mallocing_loop(void ** array, size_t size, size_t n, printFormatter pf, bool silent) {
-  if (!silent) {
+  if (!silent && !test_quiet()) {
     if (n == 1) {
       printf("mallocing %zu bytes\n", size);
     } else {
@@ -78,7 +167,12 @@ void ** mallocing_loop(void ** array, size_t size, size_t n, printFormatter pf,
       array[i] = v;
     }
   }
-  if (!silent) {
+  if (test_quiet()) {
+    digest_fold('m');
+    digest_fold(size);
+    digest_fold(n);
+    digest_state();
+  } else if (!silent) {
     tags_print(pf);
     puts("");
   }
@@ -129,7 +223,7 @@ static void check_and_free(char * p, size_t size) {
  * @param silent If true don't print anything
  */
 void freeing_loop(void ** array, size_t size, size_t n, printFormatter pf, bool silent) {
-  if (!silent) {
+  if (!silent && !test_quiet()) {
     if (n == 1) {
       printf("freeing %zu bytes (", size);
       print_pointer((char *) *array - sizeof(Header));
@@ -141,7 +235,12 @@ void freeing_loop(void ** array, size_t size, size_t n, printFormatter pf, bool
   for (size_t i = 0; i < n; i++) {
     check_and_free(array[i], size);
   }
-  if (!silent) {
+  if (test_quiet()) {
+    digest_fold('f');
+    digest_fold(size);
+    digest_fold(n);
+    digest_state();
+  } else if (!silent) {
     tags_print(pf);
     puts("");
   }
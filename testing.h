@@ -11,4 +11,14 @@ void freeing(void * p, size_t size, printFormatter pf, bool silent);
 void initialize_test();
 void finalize_test();
 
+/* Quiet mode: setting the environment variable MALLOC_TEST_QUIET to 1
+ * makes the helpers above skip all per-operation printing and instead
+ * fold every operation and heap state into a running FNV-1a digest,
+ * printed as a single line by finalize_test. The in-memory checks
+ * (zeroed contents on free, verify() after every loop) still run, so a
+ * digest diff catches the same regressions as the full text at a tiny
+ * fraction of the write-syscall cost.
+ */
+bool test_quiet();
+
 #endif // TESTING_H
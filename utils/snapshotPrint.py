@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# Render a binary heap snapshot written by tags_snapshot() in the text
+# format print_object/print_status produce, so a cheap production dump
+# can be inspected with the familiar tooling offline.
+#
+# usage: snapshotPrint.py [-s] <snapshot_file>
+#   -s  one [U]/[A]/[F]/[M] cell per block instead of the verbose format
+import struct;
+import sys;
+
+MAGIC = 0x70616e73;
+VERSION = 1;
+RECORD = struct.Struct('<QQII');
+
+STATES = {0: 'false', 1: 'true', 2: 'fencepost', 3: 'mmapped'};
+CELLS = {0: '[U]', 1: '[A]', 2: '[F]', 3: '[M]'};
+
+def printObject(rec, leftSize):
+    print('[');
+    print('\taddr: %04d' % rec[0]);
+    print('\tsize: %d' % rec[1]);
+    print('\tleft_size: %d' % leftSize);
+    print('\tallocated: %s' % STATES.get(rec[2], '?'));
+    print(']');
+
+args = sys.argv[1:];
+status = len(args) > 0 and args[0] == '-s';
+if (status):
+    args = args[1:];
+if (len(args) != 1):
+    print('usage: %s [-s] <snapshot_file>' % sys.argv[0], file=sys.stderr);
+    sys.exit(1);
+
+with open(args[0], 'rb') as f:
+    data = f.read();
+
+magic, version = struct.unpack_from('<II', data);
+if (magic != MAGIC or version != VERSION):
+    print('%s: not a heap snapshot' % args[0], file=sys.stderr);
+    sys.exit(1);
+
+# left_size is not stored; within a chunk it is the previous block's size
+leftSize = 0;
+prevChunk = None;
+for rec in RECORD.iter_unpack(data[8:]):
+    if (rec[3] != prevChunk):
+        if (status and prevChunk is not None):
+            print();
+        prevChunk = rec[3];
+        leftSize = 0;
+    if (status):
+        print(CELLS.get(rec[2], '[?]'), end='');
+    else:
+        printObject(rec, leftSize);
+    leftSize = rec[1];
+if (status):
+    print();